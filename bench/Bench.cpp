@@ -0,0 +1,319 @@
+#include "AWSManager.h"
+#include "Metrics.h"
+#include "SyncOptions.h"
+
+#include <aws/s3/model/CreateBucketRequest.h>
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+	namespace fs = std::filesystem;
+
+	constexpr std::uint64_t kibibyte{ 1024ull };
+	constexpr std::uint64_t mebibyte{ 1024ull * 1024 };
+
+	struct Options {
+		std::string endpoint{};
+		std::string bucket{};
+		std::string accessKey{ "minioadmin" };
+		std::string secretKey{ "minioadmin" };
+		std::string region{ "us-east-1" };
+		std::string scenario{ "all" };
+		int scale{ 1 };
+		fs::path workdir{ fs::temp_directory_path() / "s3-sync-bench" };
+		SyncOptions syncOptions{};
+	};
+
+	struct Usage {
+		double cpuSeconds{ 0.0 };
+		std::uint64_t peakRss{ 0 };
+	};
+
+	struct PhaseResult {
+		std::string scenario;
+		std::string phase;
+		double seconds;
+		std::uint64_t objects;
+		std::uint64_t bytes;
+		double cpuSeconds;
+		std::uint64_t peakRss;
+	};
+
+	Usage CurrentUsage()
+	{
+		Usage usage{};
+#ifdef _WIN32
+		FILETIME creation{}, exit{}, kernel{}, user{};
+		if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+			auto toSeconds{ [](const FILETIME& time) {
+				return static_cast<double>((static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 1e7;
+			} };
+			usage.cpuSeconds = toSeconds(kernel) + toSeconds(user);
+		}
+
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			usage.peakRss = counters.PeakWorkingSetSize;
+#else
+		rusage resources{};
+		if (getrusage(RUSAGE_SELF, &resources) == 0) {
+			usage.cpuSeconds = static_cast<double>(resources.ru_utime.tv_sec + resources.ru_stime.tv_sec)
+				+ static_cast<double>(resources.ru_utime.tv_usec + resources.ru_stime.tv_usec) / 1e6;
+#ifdef __APPLE__
+			usage.peakRss = static_cast<std::uint64_t>(resources.ru_maxrss);
+#else
+			usage.peakRss = static_cast<std::uint64_t>(resources.ru_maxrss) * kibibyte;
+#endif
+		}
+#endif
+		return usage;
+	}
+
+	// Random bytes are generated once and sliced, so generating gigabytes doesn't take longer than syncing them.
+	class FileWriter {
+	private:
+		std::vector<char> block;
+		std::mt19937_64 generator{ 42 };
+
+	public:
+		FileWriter()
+			: block(8 * mebibyte)
+		{
+			for (auto& byte : block)
+				byte = static_cast<char>(generator());
+		}
+
+		std::mt19937_64& Generator()
+		{
+			return generator;
+		}
+
+		void Write(const fs::path& path, std::uint64_t size)
+		{
+			fs::create_directories(path.parent_path());
+
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			std::uint64_t offset{ generator() % block.size() };
+
+			while (size > 0) {
+				const std::uint64_t chunk{ std::min<std::uint64_t>(size, block.size() - offset) };
+				file.write(block.data() + offset, static_cast<std::streamsize>(chunk));
+				size -= chunk;
+				offset = 0;
+			}
+		}
+	};
+
+	void GenerateTiny(const fs::path& root, FileWriter& writer, int scale)
+	{
+		std::uniform_int_distribution<std::uint64_t> size{ 1 * kibibyte, 4 * kibibyte };
+		for (int i = 0; i < 10000 * scale; ++i)
+			writer.Write(root / ("dir" + std::to_string(i / 100)) / ("file" + std::to_string(i) + ".txt"), size(writer.Generator()));
+	}
+
+	void GenerateHuge(const fs::path& root, FileWriter& writer, int scale)
+	{
+		for (int i = 0; i < 4 * scale; ++i)
+			writer.Write(root / ("huge" + std::to_string(i) + ".bin"), 512 * mebibyte);
+	}
+
+	void GenerateMixed(const fs::path& root, FileWriter& writer, int scale)
+	{
+		// Log-uniform sizes, so every order of magnitude from 1 KiB to 8 MiB is equally common.
+		std::uniform_real_distribution<double> exponent{ std::log2(1.0 * kibibyte), std::log2(8.0 * mebibyte) };
+		for (int i = 0; i < 1000 * scale; ++i) {
+			const auto size{ static_cast<std::uint64_t>(std::exp2(exponent(writer.Generator()))) };
+			writer.Write(root / ("dir" + std::to_string(i % 20)) / ("file" + std::to_string(i) + ".dat"), size);
+		}
+	}
+
+	void GenerateDeep(const fs::path& root, FileWriter& writer, int scale)
+	{
+		std::uniform_int_distribution<int> depth{ 8, 16 };
+		std::uniform_int_distribution<int> branch{ 0, 3 };
+		for (int i = 0; i < 2000 * scale; ++i) {
+			fs::path path{ root };
+			for (int level = depth(writer.Generator()); level > 0; --level)
+				path /= std::string(1, static_cast<char>('a' + branch(writer.Generator())));
+
+			writer.Write(path / ("file" + std::to_string(i) + ".txt"), 2 * kibibyte);
+		}
+	}
+
+	std::optional<Options> ParseOptions(int argc, char** argv)
+	{
+		Options options{};
+
+		for (int i = 1; i < argc; ++i) {
+			std::string_view arg{ argv[i] };
+			auto separator{ arg.find('=') };
+			if (!arg.starts_with("--") || separator == std::string_view::npos)
+				return std::nullopt;
+
+			std::string_view name{ arg.substr(2, separator - 2) };
+			std::string_view text{ arg.substr(separator + 1) };
+
+			int number{ 0 };
+			const bool numeric{ std::from_chars(text.data(), text.data() + text.size(), number).ec == std::errc{} && number > 0 };
+
+			if (name == "endpoint")
+				options.endpoint = text;
+			else if (name == "bucket")
+				options.bucket = text;
+			else if (name == "access-key")
+				options.accessKey = text;
+			else if (name == "secret-key")
+				options.secretKey = text;
+			else if (name == "region")
+				options.region = text;
+			else if (name == "scenario")
+				options.scenario = text;
+			else if (name == "workdir")
+				options.workdir = text;
+			else if (name == "engine" && (text == "classic" || text == "crt"))
+				options.syncOptions.engine = text == "crt" ? Engine::Crt : Engine::Classic;
+			else if (name == "scale" && numeric)
+				options.scale = number;
+			else if (name == "workers" && numeric)
+				options.syncOptions.workers = number;
+			else if (name == "max-workers" && numeric)
+				options.syncOptions.maxWorkers = number;
+			else
+				return std::nullopt;
+		}
+
+		if (options.endpoint.empty() || options.bucket.empty())
+			return std::nullopt;
+
+		options.syncOptions.endpoint = options.endpoint;
+		return options;
+	}
+
+	void PrintResults(const std::vector<PhaseResult>& results)
+	{
+		std::cout << "\n"
+			<< std::left << std::setw(8) << "scenario" << std::setw(10) << "phase"
+			<< std::right << std::setw(10) << "seconds" << std::setw(12) << "objects/s" << std::setw(10) << "MiB/s"
+			<< std::setw(10) << "cpu s" << std::setw(14) << "peak RSS MiB" << "\n";
+
+		for (const auto& result : results) {
+			const double seconds{ std::max(result.seconds, 1e-9) };
+
+			std::cout << std::left << std::setw(8) << result.scenario << std::setw(10) << result.phase
+				<< std::right << std::fixed << std::setprecision(2)
+				<< std::setw(10) << result.seconds
+				<< std::setw(12) << static_cast<double>(result.objects) / seconds
+				<< std::setw(10) << static_cast<double>(result.bytes) / static_cast<double>(mebibyte) / seconds
+				<< std::setw(10) << result.cpuSeconds
+				<< std::setw(14) << static_cast<double>(result.peakRss) / static_cast<double>(mebibyte) << "\n";
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto options{ ParseOptions(argc, argv) };
+	if (!options) {
+		std::cerr << "Usage: s3-sync-bench --endpoint=<URL> --bucket=<BUCKET> [--scenario=<tiny|huge|mixed|deep|all>] [--scale=<N>]\n"
+			<< "                     [--workdir=<PATH>] [--access-key=<KEY>] [--secret-key=<KEY>] [--region=<REGION>]\n"
+			<< "                     [--workers=<N>] [--max-workers=<N>] [--engine=<classic|crt>]\n";
+		return 1;
+	}
+
+	const std::vector<std::pair<std::string, std::function<void(const fs::path&, FileWriter&, int)>>> scenarios{
+		{ "tiny", GenerateTiny },
+		{ "huge", GenerateHuge },
+		{ "mixed", GenerateMixed },
+		{ "deep", GenerateDeep }
+	};
+
+	AWSManager manager(options->accessKey, options->secretKey, options->region, options->syncOptions);
+
+	Aws::S3::Model::CreateBucketRequest createRequest{};
+	createRequest.SetBucket(options->bucket);
+	auto createOutcome{ manager.GetClient().CreateBucket(createRequest) };
+	if (!createOutcome.IsSuccess()
+		&& createOutcome.GetError().GetErrorType() != Aws::S3::S3Errors::BUCKET_ALREADY_OWNED_BY_YOU
+		&& createOutcome.GetError().GetErrorType() != Aws::S3::S3Errors::BUCKET_ALREADY_EXISTS)
+	{
+		std::cerr << "[!] Failed to create bucket " << options->bucket << ": " << createOutcome.GetError().GetMessage() << "\n";
+		return 1;
+	}
+
+	const Metrics& metrics{ manager.GetMetrics() };
+	std::vector<PhaseResult> results{};
+	FileWriter writer{};
+
+	for (const auto& [name, generate] : scenarios) {
+		if (options->scenario != "all" && options->scenario != name)
+			continue;
+
+		const fs::path source{ options->workdir / name / "source" };
+		const fs::path destination{ options->workdir / name / "destination" };
+		const std::string location{ options->bucket + "/bench-" + name + "/" };
+
+		std::error_code ec{};
+		fs::remove_all(options->workdir / name, ec);
+
+		std::cout << "Generating " << name << " tree in " << source << "\n";
+		generate(source, writer, options->scale);
+
+		auto runPhase{ [&](std::string_view phase, const std::function<void()>& run) {
+			const std::uint64_t objectsBefore{ metrics.Objects(Metrics::Outcome::Transferred) + metrics.Objects(Metrics::Outcome::Skipped) };
+			const std::uint64_t bytesBefore{ metrics.Bytes(Metrics::Outcome::Transferred) };
+			const std::uint64_t failedBefore{ metrics.Objects(Metrics::Outcome::Failed) };
+			const Usage usageBefore{ CurrentUsage() };
+			const auto start{ std::chrono::steady_clock::now() };
+
+			run();
+
+			const double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+			const Usage usageAfter{ CurrentUsage() };
+
+			if (metrics.Objects(Metrics::Outcome::Failed) != failedBefore)
+				std::cerr << "[!] " << metrics.Objects(Metrics::Outcome::Failed) - failedBefore << " objects failed during " << name << " " << phase << "\n";
+
+			results.push_back({
+				name,
+				std::string{ phase },
+				seconds,
+				metrics.Objects(Metrics::Outcome::Transferred) + metrics.Objects(Metrics::Outcome::Skipped) - objectsBefore,
+				metrics.Bytes(Metrics::Outcome::Transferred) - bytesBefore,
+				usageAfter.cpuSeconds - usageBefore.cpuSeconds,
+				usageAfter.peakRss
+			});
+		} };
+
+		runPhase("put", [&]() { manager.put(source.string(), location); });
+		runPhase("resync", [&]() { manager.put(source.string(), location); });
+		runPhase("get", [&]() { manager.get(location, destination.string()); });
+		runPhase("reget", [&]() { manager.get(location, destination.string()); });
+		runPhase("delete", [&]() { manager.DeleteAllObjects(location); });
+
+		fs::remove_all(options->workdir / name, ec);
+	}
+
+	PrintResults(results);
+	return 0;
+}
@@ -1,16 +1,29 @@
 #include "AWSManager.h"
+#include "Checksum.h"
+#include "DirectoryScanner.h"
+#include "MappedFile.h"
+#include "Compression.h"
+#include "Chunking.h"
 
 #include <fstream>
 #include <iosfwd>
 #include <iostream>
 #include <chrono>
 
-#include <future>
 #include <vector>
 #include <algorithm>
-#include <semaphore>
+#include <atomic>
 
 #include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <map>
+#include <limits>
+#include <iterator>
+#include <charconv>
+#include <thread>
+#include <random>
+#include <type_traits>
 
 #include <aws/s3/model/ListBucketsRequest.h>
 #include <aws/s3/model/ListObjectsV2Request.h>
@@ -18,27 +31,350 @@
 #include <aws/core/utils/memory/stl/AWSStringStream.h>
 #include <aws/s3/model/PutObjectRequest.h>
 #include <aws/s3/model/GetObjectRequest.h>
+#include <aws/s3/model/HeadObjectRequest.h>
 #include <aws/core/utils/DateTime.h>
-#include <aws/s3/model/DeleteObjectRequest.h>
+#include <aws/core/utils/StringUtils.h>
+#include <aws/s3/model/DeleteObjectsRequest.h>
+#include <aws/s3/model/Delete.h>
+#include <aws/s3/model/ObjectIdentifier.h>
+#include <aws/s3/model/CreateMultipartUploadRequest.h>
+#include <aws/s3/model/UploadPartRequest.h>
+#include <aws/s3/model/CompleteMultipartUploadRequest.h>
+#include <aws/s3/model/AbortMultipartUploadRequest.h>
+#include <aws/s3/model/ListPartsRequest.h>
+#include <aws/s3/model/CompletedMultipartUpload.h>
+#include <aws/s3/model/CompletedPart.h>
+#include <aws/s3/model/CopyObjectRequest.h>
+#include <aws/s3/model/UploadPartCopyRequest.h>
+#include <aws/core/client/DefaultRetryStrategy.h>
+
+#ifdef S3SYNC_HAVE_CRT
+#include <aws/s3-crt/S3CrtClient.h>
+#include <aws/s3-crt/ClientConfiguration.h>
+#include <aws/s3-crt/model/PutObjectRequest.h>
+#include <aws/s3-crt/model/GetObjectRequest.h>
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// Downloads are written under this suffix and renamed into place once complete.
+	constexpr std::string_view partialSuffix{ ".s3sync-partial" };
+
+	// Keys and bundled paths come from the bucket, so one that is absolute or climbs out with ".." must not pick where a file lands.
+	std::optional<std::filesystem::path> LocalPathUnder(const std::filesystem::path& root, std::string_view relativePath)
+	{
+		const std::filesystem::path relative{ relativePath };
+		if (relative.empty() || relative.has_root_path())
+			return std::nullopt;
+
+		const auto inside{ (root / relative).lexically_normal().lexically_relative(root.lexically_normal()) };
+		if (inside.empty() || *inside.begin() == ".." || *inside.begin() == ".")
+			return std::nullopt;
+
+		return root / relative;
+	}
+
+	// x-amz-copy-source has to be URL-encoded; each key segment is encoded on its own so the '/' between them stays.
+	std::string CopySource(std::string_view bucket, std::string_view key)
+	{
+		std::string source{ bucket };
+
+		for (;;) {
+			const auto separator{ key.find('/') };
+			source += '/';
+			source += Aws::Utils::StringUtils::URLEncode(std::string{ key.substr(0, separator) }.c_str());
+
+			if (separator == std::string_view::npos)
+				return source;
+			key.remove_prefix(separator + 1);
+		}
+	}
+
+	bool PreallocateFile(const std::filesystem::path& path, std::uint64_t size)
+	{
+#ifdef __linux__
+		int fd{ ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+		if (fd < 0)
+			return false;
+
+		// posix_fallocate reserves the blocks up front; fall back to a sparse file if the filesystem can't.
+		bool allocated{ size == 0 || ::posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0 };
+		if (!allocated)
+			allocated = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+
+		::close(fd);
+		return allocated;
+#else
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return false;
+		}
+
+		std::error_code ec{};
+		std::filesystem::resize_file(path, size, ec);
+		return !ec;
+#endif
+	}
+
+	// A journal only applies to the exact file, object version and part size it was written for.
+	bool SameTransfer(const JournalHeader& previous, const JournalHeader& expected)
+	{
+		return !previous.id.empty()
+			&& previous.bucket == expected.bucket
+			&& previous.key == expected.key
+			&& previous.size == expected.size
+			&& previous.modifiedTime == expected.modifiedTime
+			&& previous.partSize == expected.partSize
+			&& (expected.id.empty() || previous.id == expected.id);
+	}
+
+	bool IsThrottleType(Aws::S3::S3Errors type)
+	{
+		switch (type) {
+		case Aws::S3::S3Errors::SLOW_DOWN:
+		case Aws::S3::S3Errors::THROTTLING:
+		case Aws::S3::S3Errors::REQUEST_TIMEOUT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+#ifdef S3SYNC_HAVE_CRT
+	bool IsThrottleType(Aws::S3Crt::S3CrtErrors type)
+	{
+		switch (type) {
+		case Aws::S3Crt::S3CrtErrors::SLOW_DOWN:
+		case Aws::S3Crt::S3CrtErrors::THROTTLING:
+		case Aws::S3Crt::S3CrtErrors::REQUEST_TIMEOUT:
+			return true;
+		default:
+			return false;
+		}
+	}
+#endif
+
+	// SlowDown, 503s and timeouts mean too many requests are in flight, not that this one was bad.
+	template<typename S3Error>
+	bool IsThrottle(const S3Error& error)
+	{
+		switch (error.GetResponseCode()) {
+		case Aws::Http::HttpResponseCode::SERVICE_UNAVAILABLE:
+		case Aws::Http::HttpResponseCode::TOO_MANY_REQUESTS:
+		case Aws::Http::HttpResponseCode::REQUEST_TIMEOUT:
+			return true;
+		default:
+			break;
+		}
+
+		return IsThrottleType(error.GetErrorType());
+	}
+
+	template<typename Request>
+	constexpr bool isCrtGet{ false };
+
+#ifdef S3SYNC_HAVE_CRT
+	template<>
+	constexpr bool isCrtGet<Aws::S3Crt::Model::GetObjectRequest>{ true };
+#endif
+
+	template<typename Request>
+	constexpr Metrics::Request RequestKind()
+	{
+		using namespace Aws::S3::Model;
+
+		if constexpr (std::is_same_v<Request, ListObjectsV2Request>)
+			return Metrics::Request::List;
+		else if constexpr (std::is_same_v<Request, GetObjectRequest> || std::is_same_v<Request, HeadObjectRequest> || isCrtGet<Request>)
+			return Metrics::Request::Get;
+		else if constexpr (std::is_same_v<Request, DeleteObjectsRequest>)
+			return Metrics::Request::Delete;
+		else if constexpr (std::is_same_v<Request, CopyObjectRequest> || std::is_same_v<Request, UploadPartCopyRequest>)
+			return Metrics::Request::Copy;
+		else if constexpr (std::is_same_v<Request, CreateMultipartUploadRequest> || std::is_same_v<Request, CompleteMultipartUploadRequest>
+			|| std::is_same_v<Request, AbortMultipartUploadRequest> || std::is_same_v<Request, ListPartsRequest>)
+			return Metrics::Request::Multipart;
+		else
+			return Metrics::Request::Put;
+	}
+
+	// Full jitter: a random delay up to an exponentially growing cap, so retries from many workers don't line up.
+	std::chrono::milliseconds Backoff(int attempt)
+	{
+		constexpr std::int64_t baseDelayMs{ 100 };
+		constexpr std::int64_t maxDelayMs{ 20000 };
+
+		thread_local std::mt19937_64 generator{ std::random_device{}() };
+
+		const std::int64_t cap{ std::min(maxDelayMs, baseDelayMs << std::min(attempt, 16)) };
+		return std::chrono::milliseconds{ std::uniform_int_distribution<std::int64_t>{ 0, cap }(generator) };
+	}
+
+	// Creates a new, empty file with a random name, never opening one that's already there,
+	// so other threads and other s3-sync processes sharing the directory can't collide on it.
+	std::optional<std::filesystem::path> CreateTempFile(const std::filesystem::path& directory, std::string_view extension)
+	{
+		constexpr int maxAttempts{ 16 };
+
+		thread_local std::mt19937_64 generator{ std::random_device{}() };
+
+		for (int attempt = 0; attempt < maxAttempts; ++attempt) {
+			std::filesystem::path path{ directory / ("s3sync-" + std::to_string(generator()) + std::string{ extension }) };
+			std::ofstream file(path, std::ios::binary | std::ios::noreplace);
+			if (file.is_open())
+				return path;
+		}
+
+		return std::nullopt;
+	}
+}
+
+// Defined whether or not the build has the CRT client, so the header looks the same to everything that includes it.
+struct AWSManager::CrtClient {
+#ifdef S3SYNC_HAVE_CRT
+	Aws::S3Crt::S3CrtClient client;
+
+	CrtClient(const Aws::Auth::AWSCredentials& credentials, const Aws::S3Crt::ClientConfiguration& config, bool virtualAddressing)
+		: client{ credentials, config, Aws::Client::AWSAuthV4Signer::PayloadSigningPolicy::RequestDependent, virtualAddressing }
+	{
+	}
+#endif
+};
+
+template<typename Request, typename Call>
+auto AWSManager::Transfer(Request& request, std::uint64_t bytes, Call call) -> decltype(call())
+{
+	for (int attempt = 0; ; ++attempt) {
+		// A retry has to send the body again from the start.
+		if constexpr (requires { request.GetBody(); }) {
+			if (attempt > 0) {
+				if (auto body{ request.GetBody() }) {
+					body->clear();
+					body->seekg(0);
+				}
+			}
+		}
+
+		controller->Acquire();
+
+		const auto start{ std::chrono::steady_clock::now() };
+		auto outcome{ call() };
+		const auto latency{ std::chrono::steady_clock::now() - start };
+		metrics.RecordRequest(RequestKind<Request>(), latency);
+
+		if (outcome.IsSuccess()) {
+			controller->Release(bytes, latency, ConcurrencyController::Signal::Success);
+			return outcome;
+		}
 
-AWSManager::AWSManager(std::string_view accessKey, std::string_view secretKey, std::string_view region)
+		const bool throttled{ IsThrottle(outcome.GetError()) };
+		controller->Release(0, latency, throttled ? ConcurrencyController::Signal::Throttled : ConcurrencyController::Signal::Failed);
+
+		if (attempt >= syncOptions.retries || !(throttled || outcome.GetError().ShouldRetry()))
+			return outcome;
+
+		metrics.RecordRetry();
+		std::this_thread::sleep_for(Backoff(attempt));
+	}
+}
+
+AWSManager::AWSManager(std::string_view accessKey, std::string_view secretKey, std::string_view region, const SyncOptions& syncOptions)
+	: syncOptions{ syncOptions }, filter{ syncOptions.includes, syncOptions.excludes }
 {
 	options = Aws::SDKOptions{};
 	Aws::InitAPI(options);
 
+	const int initialWorkers{ std::max(syncOptions.workers, 1) };
+	const int maxWorkers{ std::max(syncOptions.maxWorkers, initialWorkers) };
+
 	credentials.emplace(accessKey.data(), secretKey.data());
 	config.emplace();
 	config->region = region;
+	// Enough connections for the controller's ceiling, and no SDK retries underneath it, so it sees every throttle.
+	config->maxConnections = static_cast<unsigned>(syncOptions.maxConnections > 0 ? syncOptions.maxConnections : maxWorkers);
+	config->retryStrategy = Aws::MakeShared<Aws::Client::DefaultRetryStrategy>("s3-sync", 0);
+
+	if (syncOptions.connectTimeout.count() > 0)
+		config->connectTimeoutMs = static_cast<long>(syncOptions.connectTimeout.count());
+	if (syncOptions.requestTimeout.count() > 0)
+		config->requestTimeoutMs = static_cast<long>(syncOptions.requestTimeout.count());
+
+	// Probes keep pooled connections from being dropped silently by NATs and load balancers between requests.
+	config->enableTcpKeepAlive = syncOptions.tcpKeepAlive;
+	if (syncOptions.keepAliveInterval.count() > 0)
+		config->tcpKeepAliveIntervalMs = static_cast<unsigned long>(std::chrono::milliseconds(syncOptions.keepAliveInterval).count());
+
+	// The SDK charges these from its HTTP layer, so one pair of buckets covers every connection.
+	if (syncOptions.uploadLimit || syncOptions.downloadLimit || !syncOptions.limitFile.empty()) {
+		bandwidth = std::make_unique<BandwidthLimiter>(syncOptions.uploadLimit, syncOptions.downloadLimit, syncOptions.limitFile, metrics);
+		config->writeRateLimiter = bandwidth->UploadLimiter();
+		config->readRateLimiter = bandwidth->DownloadLimiter();
+	}
+
+	// S3-compatible stores (MinIO and the like) generally only do path-style bucket addressing.
+	const bool customEndpoint{ !syncOptions.endpoint.empty() };
+	if (customEndpoint) {
+		config->endpointOverride = syncOptions.endpoint;
+		if (syncOptions.endpoint.starts_with("http://"))
+			config->scheme = Aws::Http::Scheme::HTTP;
+	}
+
 	client = std::make_unique<Aws::S3::S3Client>(
 		*credentials,
 		*config,
 		Aws::Client::AWSAuthV4Signer::PayloadSigningPolicy::RequestDependent,
-		true
+		!customEndpoint
 	);
+
+	if (syncOptions.engine == Engine::Crt) {
+#ifdef S3SYNC_HAVE_CRT
+		Aws::S3Crt::ClientConfiguration crtConfig{};
+		crtConfig.region = config->region;
+		crtConfig.endpointOverride = config->endpointOverride;
+		crtConfig.scheme = config->scheme;
+		crtConfig.connectTimeoutMs = config->connectTimeoutMs;
+		crtConfig.requestTimeoutMs = config->requestTimeoutMs;
+		crtConfig.enableTcpKeepAlive = config->enableTcpKeepAlive;
+		crtConfig.tcpKeepAliveIntervalMs = config->tcpKeepAliveIntervalMs;
+		// The CRT client sizes its own connection pool from the throughput target rather than from maxConnections.
+		crtConfig.throughputTargetGbps = static_cast<double>(syncOptions.throughputTarget);
+		// Clamped like the classic uploads, so Checksum::FileETag predicts the same parts.
+		crtConfig.partSize = Checksum::PartSize(0, syncOptions.partSize);
+
+		crt = std::make_unique<CrtClient>(*credentials, crtConfig, !customEndpoint);
+
+		// Its HTTP layer is its own, so the rate limiters above never see its traffic.
+		if (bandwidth)
+			std::cerr << "[!] Bandwidth limits don't apply to transfers made by the CRT engine\n";
+#else
+		std::cerr << "[!] This build has no CRT support, using the classic S3 client\n";
+#endif
+	}
+
+	if (this->syncOptions.compress && !Compression::Available()) {
+		std::cerr << "[!] This build has no zstd support, uploading without compression\n";
+		this->syncOptions.compress = false;
+	}
+
+	// The pool has a thread for every request the controller may ever allow; the controller decides how many are in flight.
+	controller = std::make_unique<ConcurrencyController>(initialWorkers, maxWorkers);
+
+	// Two buffers per transfer thread covers read-ahead on one body while the next one is opened.
+	if (this->syncOptions.ioUring)
+		io = IoEngine::Create(std::clamp<std::size_t>(static_cast<std::size_t>(maxWorkers) * 2, 16, 256));
+
+	pool = std::make_unique<TransferPool>(maxWorkers, static_cast<std::size_t>(maxWorkers) * 64);
 }
 
 AWSManager::~AWSManager()
 {
+	pool.reset();
+	crt.reset();
 	client.reset();
 	Aws::ShutdownAPI(this->options);
 }
@@ -98,276 +434,2216 @@ std::expected<std::vector<std::string>, Error::ErrorCode> AWSManager::GetFilePat
 std::expected<int, Error::ErrorCode> AWSManager::put(std::string_view srcFilePath, std::string_view dstBucket)
 {
 	namespace fs = std::filesystem;
-	constexpr int maxThreads{ 8 };
-
-	auto files{ GetRelativeFilePaths(srcFilePath) };
-	auto tempFilePath{ NormalizePathForS3(srcFilePath) };
 
-	std::counting_semaphore<maxThreads> sem(maxThreads);
+	TransferPool::Group group{};
 	std::mutex coutMutex{};
-	std::vector<std::future<void>> futures;
 
-	auto objects{ GetObjects(dstBucket) };
-	if (!objects) {
-		if (objects.error() != Error::ErrorCode::NoObjects)
-			return std::unexpected(objects.error());
-	}
+	const S3Location location{ S3Location::Parse(dstBucket) };
 
-	std::unordered_map<std::string, std::time_t> remoteTimestamps{};
+	auto manifest{ OpenManifest(srcFilePath, dstBucket) };
+	// With a trusted manifest the bucket doesn't need to be listed at all, unless it's mirrored and extra objects have to be found.
+	const bool fullListing{ !manifest || ShouldReconcile(*manifest) || syncOptions.mirror };
 
-	if (objects.has_value()) {
-		for (const auto& object : objects.value())
-			remoteTimestamps[object.GetKey()] = object.GetLastModified().Seconds();
+	RemoteIndex remoteObjects{};
+	if (fullListing) {
+		auto listing{ IndexObjects(dstBucket) };
+		if (!listing) {
+			if (listing.error() != Error::ErrorCode::NoObjects)
+				return std::unexpected(listing.error());
+		}
+		else
+			remoteObjects = std::move(listing.value());
 	}
 
-	int fileCount{ 0 };
+	std::atomic<int> fileCount{ 0 };
 
-	for (const auto& file : files) {
-		sem.acquire();
-		futures.push_back(std::async(std::launch::async, [&, file]() {
+	std::vector<ScannedFile> smallFiles{};
+	std::mutex smallFilesMutex{};
+
+	std::vector<std::string> localKeys{};
+	std::mutex localKeysMutex{};
+
+	// Uploads are queued while the scan is still walking the tree; the size and mtime come from the scan itself.
+	auto scan{ DirectoryScanner::Scan(srcFilePath, *pool, [&](ScannedFile scanned) {
+		if (scanned.relativePath.ends_with(partialSuffix) || scanned.relativePath.starts_with(BundleIndex::internalPrefix))
+			return;
+
+		if (syncOptions.mirror) {
+			std::lock_guard<std::mutex> lock(localKeysMutex);
+			localKeys.push_back(location.KeyFor(scanned.relativePath));
+		}
+
+		// Small files are packed into bundles once the scan has found them all.
+		if (syncOptions.bundle && scanned.size < syncOptions.bundleThreshold) {
+			std::lock_guard<std::mutex> lock(smallFilesMutex);
+			smallFiles.push_back(std::move(scanned));
+			return;
+		}
+
+		pool->Submit(group, [&, scanned = std::move(scanned)]() {
+			const std::string& file{ scanned.relativePath };
 			fs::path path = srcFilePath;
 			path /= file;
-			std::string key = file;
-			/*
-			size_t pos = key.find(tempFilePath);
-			if (pos != std::string::npos)
-				key.erase(pos, tempFilePath.length());
-			if (!key.empty() && key.at(0) == '/')
-				key.erase(0, 1);
-				*/
-
-			std::time_t localTime = std::chrono::system_clock::to_time_t(
-				std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-					fs::last_write_time(path) - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
-				)
-			);
-
-			if (remoteTimestamps.contains(key) && localTime <= remoteTimestamps[key]) {
-				{
-					std::lock_guard<std::mutex> lock(coutMutex);
+			std::string key = location.KeyFor(file);
+
+			const std::uint64_t fileSize{ scanned.size };
+			const fs::file_time_type fileTime{ scanned.modifiedTime };
+			const std::int64_t modifiedTime{ static_cast<std::int64_t>(fileTime.time_since_epoch().count()) };
+
+			const std::optional<RemoteObject> remoteObject{ remoteObjects.Find(key) };
+
+			if (manifest) {
+				auto entry{ manifest->Find(key) };
+				bool unchanged{ entry && entry->size == fileSize && entry->modifiedTime == modifiedTime };
+				if (unchanged && fullListing)
+					unchanged = remoteObject && remoteObject->eTag == entry->eTag;
+
+				if (unchanged) {
+					manifest->Touch(key);
+					metrics.Record(Metrics::Outcome::Skipped, fileSize);
+					return;
 				}
-				sem.release();
-				return;
 			}
 
-			Aws::S3::Model::PutObjectRequest request;
-			request.SetBucket(dstBucket);
-			request.SetKey(key);
-
-			std::shared_ptr<Aws::IOStream> inputData = Aws::MakeShared<Aws::FStream>(
-				key.c_str(), path.c_str(), std::ios_base::in | std::ios_base::binary
-			);
+			if (syncOptions.compareMode == CompareMode::Checksum) {
+				// Compare against the listed object, or the manifest when the bucket wasn't listed.
+				std::optional<ManifestEntry> reference{};
+				if (remoteObject)
+					reference = ManifestEntry{ remoteObject->size, 0, std::string(remoteObject->eTag) };
+				else if (manifest && !fullListing)
+					reference = manifest->Find(key);
+
+				// A compressed or chunked object's size and ETag describe its body, so look up the original's instead.
+				std::optional<ManifestEntry> original{ reference };
+				if (reference && reference->size != fileSize && (syncOptions.compress || syncOptions.chunk))
+					original = EncodedOriginal(location.bucket, key);
+
+				// Different sizes can never match, so only hash when they agree.
+				if (original && original->size == fileSize) {
+					auto localETag{ Checksum::FileETag(path, fileSize, syncOptions, *pool) };
+					if (localETag && Checksum::SameETag(localETag.value(), original->eTag)) {
+						if (manifest)
+							manifest->Update(key, { fileSize, modifiedTime, reference->eTag });
+						metrics.Record(Metrics::Outcome::Skipped, fileSize);
+						return;
+					}
+				}
+			}
+			else {
+				std::time_t localTime = std::chrono::system_clock::to_time_t(
+					std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+						fileTime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
+					)
+				);
+
+				if (remoteObject && localTime <= remoteObject->lastModified) {
+					if (manifest)
+						manifest->Update(key, { fileSize, modifiedTime, std::string(remoteObject->eTag) });
+					metrics.Record(Metrics::Outcome::Skipped, fileSize);
+					return;
+				}
+			}
 
-			if (!inputData || !inputData->good()) {
+			if (syncOptions.dryRun) {
 				std::lock_guard<std::mutex> lock(coutMutex);
-				std::cerr << "[!] Failed to open file: " << file << "\n";
-				sem.release();
-				return; // OpenFileFailed
+				std::cout << "[dry-run] upload " << key << "\n";
+				++fileCount;
+				return;
 			}
 
-			request.SetBody(inputData);
+			auto result{ UploadFile(location, key, path, fileSize) };
+			if (!result) {
+				metrics.Record(Metrics::Outcome::Failed, fileSize);
 
-			auto outcome = GetClient().PutObject(request);
-			if (!outcome.IsSuccess()) {
 				std::lock_guard<std::mutex> lock(coutMutex);
-				std::cerr << "[!] Failed to upload: " << key << "\n";
-				// UploadFailed
+				if (result.error() == Error::ErrorCode::OpenFileFailed)
+					std::cerr << "[!] Failed to open file: " << file << "\n";
+				else
+					std::cerr << "[!] Failed to upload: " << key << "\n";
 			}
 			else {
-				std::lock_guard<std::mutex> lock(coutMutex);
+				if (manifest)
+					manifest->Update(key, { fileSize, modifiedTime, result.value() });
+
+				metrics.Record(Metrics::Outcome::Transferred, fileSize);
 				++fileCount;
 			}
+		});
+	}, &filter) };
 
-			sem.release();
-		}));
+	pool->Wait(group);
+
+	// Mirroring also has to drop deleted files from the bundle index, even when no small files are left.
+	const bool pruneBundles{ syncOptions.bundle && syncOptions.mirror && scan.has_value() };
+	if (!smallFiles.empty() || pruneBundles) {
+		auto bundled{ PutBundles(location, srcFilePath, std::move(smallFiles), pruneBundles) };
+		if (bundled)
+			fileCount += bundled.value();
+		else
+			std::cerr << "[!] Failed to upload bundles: " << Error::ErrorParser(bundled.error()) << "\n";
 	}
 
-	for (auto& f : futures)
-		f.wait();
+	if (!scan) {
+		if (scan.error() == Error::ErrorCode::NoFilePath)
+			return std::unexpected(scan.error());
 
-	return fileCount;
-}
+		// Don't prune manifest entries, or mirror deletions, for directories that couldn't be read.
+		std::cerr << "[!] Some directories under " << srcFilePath << " could not be read\n";
+		return fileCount.load();
+	}
 
-Aws::S3::S3Client& AWSManager::GetClient()
-{
-	return *client;
+	if (syncOptions.mirror)
+		DeleteExtraneous(location, std::move(localKeys), remoteObjects, false);
+
+	if (manifest)
+		CloseManifest(*manifest);
+
+	return fileCount.load();
 }
 
-std::expected<std::vector<Aws::S3::Model::Object>, Error::ErrorCode> AWSManager::GetObjects(std::string_view bucketName)
+std::expected<int, Error::ErrorCode> AWSManager::watch(std::string_view srcFilePath, std::string_view dstBucket, const std::atomic<bool>& stop)
 {
-	Aws::S3::Model::ListObjectsV2Request request{};
-	request.WithBucket(bucketName);
+	using Clock = std::chrono::steady_clock;
 
-	Aws::String continuationToken{};
-	std::vector<Aws::S3::Model::Object> objects{};
+	// Subscribe before the initial sync, so nothing written while it runs slips through.
+	auto watcher{ DirectoryWatcher::Open(srcFilePath, &filter) };
+	if (!watcher) {
+		if (syncOptions.watchReconcile.count() == 0)
+			return std::unexpected(watcher.error());
 
-	do
-	{
-		if (!continuationToken.empty())
-			request.SetContinuationToken(continuationToken);
+		std::cerr << "[!] " << Error::ErrorParser(watcher.error()) << " Falling back to a full sync every "
+			<< syncOptions.watchReconcile.count() << " seconds.\n";
+	}
 
-		auto outcome{ GetClient().ListObjectsV2(request) };
-		if (outcome.IsSuccess()) {
-			std::vector<Aws::S3::Model::Object> tempObjects{ outcome.GetResult().GetContents() };
+	auto synced{ put(srcFilePath, dstBucket) };
+	if (!synced)
+		return synced;
 
-			objects.insert(objects.end(), tempObjects.begin(), tempObjects.end());
-			continuationToken = outcome.GetResult().GetNextContinuationToken();
-		}
+	int fileCount{ synced.value() };
+
+	const S3Location location{ S3Location::Parse(dstBucket) };
+	// One manifest for the whole session, saved after every batch instead of reloaded for each.
+	auto manifest{ OpenManifest(srcFilePath, dstBucket) };
+
+	// Poll in short steps so a stop request doesn't wait out a long delay.
+	const std::chrono::milliseconds pollInterval{ std::min<std::chrono::milliseconds>(syncOptions.watchDelay, std::chrono::seconds(1)) };
+	// A file that's rewritten non-stop still goes up at least this often.
+	const std::chrono::milliseconds maxDelay{ syncOptions.watchDelay * 10 };
+
+	std::set<std::string> changed{};
+	Clock::time_point firstChange{};
+	Clock::time_point lastChange{};
+	Clock::time_point nextReconcile{ Clock::now() + syncOptions.watchReconcile };
+
+	while (!stop) {
+		const std::size_t pending{ changed.size() };
+		bool complete{ true };
+
+		if (watcher)
+			complete = watcher.value()->Poll(pollInterval, changed);
 		else
-			return std::unexpected(Error::ErrorCode::RetrieveFailed);
+			std::this_thread::sleep_for(pollInterval);
 
-	} while (!continuationToken.empty());
+		const auto now{ Clock::now() };
+		if (changed.size() != pending) {
+			if (pending == 0)
+				firstChange = now;
+			lastChange = now;
+		}
 
-	return objects;
-}
+		// Lost events leave a full scan as the only way to be sure nothing was missed.
+		if (!complete || (syncOptions.watchReconcile.count() != 0 && now >= nextReconcile)) {
+			changed.clear();
+			manifest.reset();
 
-std::expected<void, Error::ErrorCode> AWSManager::ListObjects(std::string_view bucketName)
-{
-	auto objects{ GetObjects(bucketName) };
-	if (!objects.has_value())
-		return std::unexpected(Error::ErrorCode::NoObjects);
+			const bool reconcile{ std::exchange(syncOptions.reconcile, true) };
+			auto full{ put(srcFilePath, dstBucket) };
+			syncOptions.reconcile = reconcile;
 
-	std::cout << bucketName << " Objects:\n";
-	for (const auto& object : objects.value()) {
-		std::cout << " - " << object.GetKey() << "\n";
-		std::cout << "   " << "Last modified: " << object.GetLastModified().ToGmtString(Aws::Utils::DateFormat::ISO_8601) << "\n";
+			if (full)
+				fileCount += full.value();
+			else
+				std::cerr << "[!] Full sync failed: " << Error::ErrorParser(full.error()) << "\n";
+
+			manifest = OpenManifest(srcFilePath, dstBucket);
+			nextReconcile = Clock::now() + syncOptions.watchReconcile;
+			continue;
+		}
+
+		// Coalesce bursts (an editor's save, an extracted archive) into one batch once the tree goes quiet.
+		if (!changed.empty() && (now - lastChange >= syncOptions.watchDelay || now - firstChange >= maxDelay))
+			fileCount += UploadChanged(location, srcFilePath, std::exchange(changed, {}), manifest.get());
 	}
 
-	return{};
+	if (!changed.empty())
+		fileCount += UploadChanged(location, srcFilePath, changed, manifest.get());
+
+	return fileCount;
 }
 
-std::expected<int, Error::ErrorCode> AWSManager::get(std::string_view srcBucket, std::string_view dstPath)
+int AWSManager::UploadChanged(const S3Location& location, const std::filesystem::path& root, const std::set<std::string>& files, Manifest* manifest)
 {
 	namespace fs = std::filesystem;
-	constexpr int maxThreads{ 8 };
-
-	fs::path p{ dstPath };
-	auto objects{ GetObjects(srcBucket) };
-	if (!objects.has_value())
-		return std::unexpected(Error::ErrorCode::NoObjects);
 
-	std::counting_semaphore<maxThreads> sem(maxThreads);
+	TransferPool::Group group{};
 	std::mutex coutMutex{};
-	std::vector<std::future<void>> futures{};
+	std::atomic<int> fileCount{ 0 };
+	std::vector<ScannedFile> smallFiles{};
 
-	int fileCount{ 0 };
-
-	for (const auto& object : objects.value()) {
-		sem.acquire();
+	for (const auto& file : files) {
+		if (file.ends_with(partialSuffix) || file.starts_with(BundleIndex::internalPrefix) || !filter.Admits(file))
+			continue;
+
+		// Gone again by the time the batch runs; with --mirror the next full sync deletes its object.
+		const fs::path path{ root / fs::path(file) };
+		std::error_code ec{};
+		if (!fs::is_regular_file(path, ec))
+			continue;
+
+		ScannedFile scanned{ file, fs::file_size(path, ec), {} };
+		if (!ec)
+			scanned.modifiedTime = fs::last_write_time(path, ec);
+		if (ec)
+			continue;
+
+		const std::string key{ location.KeyFor(file) };
+		const std::uint64_t fileSize{ scanned.size };
+		const std::int64_t modifiedTime{ static_cast<std::int64_t>(scanned.modifiedTime.time_since_epoch().count()) };
+
+		// Events for a file that ends up unchanged (a chmod, a save without edits) are caught here without a request.
+		if (manifest) {
+			auto entry{ manifest->Find(key) };
+			if (entry && entry->size == fileSize && entry->modifiedTime == modifiedTime) {
+				metrics.Record(Metrics::Outcome::Skipped, fileSize);
+				continue;
+			}
+		}
 
-		futures.push_back(std::async(std::launch::async, [&, object]() {
-			fs::path tempPath = p / object.GetKey();
+		if (syncOptions.bundle && fileSize < syncOptions.bundleThreshold) {
+			smallFiles.push_back(std::move(scanned));
+			continue;
+		}
 
-			bool shouldDownload{ true };
+		pool->Submit(group, [&, path, key, fileSize, modifiedTime]() {
+			if (syncOptions.dryRun) {
+				std::lock_guard<std::mutex> lock(coutMutex);
+				std::cout << "[dry-run] upload " << key << "\n";
+				++fileCount;
+				return;
+			}
 
-			if (fs::exists(tempPath) && fs::is_regular_file(tempPath)) {
-				auto ftime{ fs::last_write_time(tempPath) };
-				auto sctp{ std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-					ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
-				) };
-				std::time_t fileUnixTime{ std::chrono::system_clock::to_time_t(sctp) };
-				std::time_t objectUnixTime{ object.GetLastModified().Seconds() };
+			auto result{ UploadFile(location, key, path, fileSize) };
+			if (!result) {
+				metrics.Record(Metrics::Outcome::Failed, fileSize);
 
-				if (fileUnixTime > objectUnixTime)
-					shouldDownload = false;
+				std::lock_guard<std::mutex> lock(coutMutex);
+				std::cerr << "[!] Failed to upload: " << key << "\n";
+				return;
 			}
 
-			if (shouldDownload) {
-				auto result{ DownloadObjectToPath(
-					srcBucket, p, object.GetKey()
-				) };
+			if (manifest)
+				manifest->Update(key, { fileSize, modifiedTime, result.value() });
 
-				if (!result) {
-					std::lock_guard<std::mutex> lock(coutMutex);
-					std::cout << "[!] Failed to download " << srcBucket << "/" << object.GetKey() << "\n";
-					// DownloadFailed
-				}
-				else 
-				{
-					std::lock_guard<std::mutex> lock(coutMutex);
-					++fileCount;
-				}
-			}
+			metrics.Record(Metrics::Outcome::Transferred, fileSize);
+			++fileCount;
+		});
+	}
 
-			sem.release();
-		}));
+	pool->Wait(group);
+
+	if (!smallFiles.empty()) {
+		auto bundled{ PutBundles(location, root, std::move(smallFiles)) };
+		if (bundled)
+			fileCount += bundled.value();
+		else
+			std::cerr << "[!] Failed to upload bundles: " << Error::ErrorParser(bundled.error()) << "\n";
 	}
 
-	for (auto& f : futures)
-		f.wait();
+	// Saved without pruning: a batch only sees the files that changed, not the ones that are still there.
+	if (manifest) {
+		auto saved{ manifest->Save() };
+		if (!saved)
+			std::cerr << "[!] " << Error::ErrorParser(saved.error()) << "\n";
+	}
 
-	return fileCount;
+	if (fileCount > 0)
+		std::cout << "Uploaded " << fileCount << " changed objects\n";
+
+	return fileCount.load();
 }
 
-std::expected<std::pair<int, int>, Error::ErrorCode> AWSManager::DeleteAllObjects(std::string_view bucketName)
+std::expected<std::shared_ptr<Aws::IOStream>, Error::ErrorCode> AWSManager::OpenBody(const std::filesystem::path& path, std::uint64_t offset, std::uint64_t length)
 {
-	auto objects{ GetObjects(bucketName) };
-	if (!objects.has_value())
-		return std::unexpected(Error::ErrorCode::RetrieveFailed);
-	if (objects.value().empty())
-		return std::unexpected(Error::ErrorCode::NoObjects);
+	if (io)
+		return io->OpenReader(path, offset, length);
 
-	int deletedObjects{ 0 };
+	// Without a ring the body is a view of the file, so nothing is read into an intermediate buffer.
+	auto mappedFile{ MappedFile::Open(path, offset, length) };
+	if (!mappedFile)
+		return std::unexpected(mappedFile.error());
 
-	for (const auto& object : objects.value()) {
-		Aws::S3::Model::DeleteObjectRequest request{};
-		request.WithKey(object.GetKey()).WithBucket(bucketName);
+	return Aws::MakeShared<MappedStream>("s3-sync", std::move(mappedFile.value()));
+}
 
-		auto outcome{ GetClient().DeleteObject(request) };
-		if (outcome.IsSuccess()) {
-			++deletedObjects;
-		}
-	}
+Aws::IOStream* AWSManager::OpenSink(const std::filesystem::path& path, std::uint64_t offset, bool truncate)
+{
+	if (io)
+		return io->OpenWriter(path, offset, truncate);
+
+	if (truncate)
+		return Aws::New<Aws::FStream>("s3-sync", path.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
 
-	return std::make_pair(deletedObjects, objects.value().size());
+	auto* stream{ Aws::New<Aws::FStream>("s3-sync", path.c_str(), std::ios_base::in | std::ios_base::out | std::ios_base::binary) };
+	stream->seekp(static_cast<std::streamoff>(offset));
+	return stream;
 }
 
-std::vector<std::string> AWSManager::GetRelativeFilePaths(std::string_view rootPath)
+std::unique_ptr<Manifest> AWSManager::OpenManifest(const std::filesystem::path& localPath, std::string_view bucket)
 {
-	std::vector<std::string> temp{};
+	// A dry run works from the bucket as it is, and leaves no state behind.
+	if (!syncOptions.useManifest || syncOptions.dryRun)
+		return nullptr;
 
-	namespace fs = std::filesystem;
-	for (const auto& entry : fs::recursive_directory_iterator(rootPath)) {
-		if (entry.is_regular_file())
-			temp.push_back(NormalizePathForS3(std::filesystem::relative(entry.path(), rootPath)));
-	}
+	auto manifest{ std::make_unique<Manifest>(Manifest::PathFor(syncOptions.stateDirectory, localPath, bucket)) };
+	if (!manifest->Load())
+		std::cerr << "[!] " << Error::ErrorParser(Error::ErrorCode::CorruptManifest) << " Doing a full sync.\n";
 
-	return temp;
+	return manifest;
 }
 
-std::string AWSManager::NormalizePathForS3(const std::filesystem::path& path)
+bool AWSManager::ShouldReconcile(const Manifest& manifest)
 {
-	return path.generic_string();
+	// A fresh manifest, an explicit request, or every Nth run checks against the bucket instead of trusting the manifest.
+	if (syncOptions.reconcile || manifest.Empty())
+		return true;
+
+	return syncOptions.reconcileInterval != 0 && manifest.Generation() % syncOptions.reconcileInterval == 0;
 }
 
-std::expected<void, Error::ErrorCode> AWSManager::DownloadObjectToPath(std::string_view srcBucket, const std::filesystem::path& dstPath, std::string_view objectKey)
+void AWSManager::CloseManifest(Manifest& manifest)
 {
-	std::filesystem::path tempPath{ dstPath };
-	tempPath /= objectKey;
+	manifest.Prune();
 
-	Aws::S3::Model::GetObjectRequest request{};
-	request.SetBucket(srcBucket);
-	request.SetKey(objectKey);
+	auto result{ manifest.Save() };
+	if (!result)
+		std::cerr << "[!] " << Error::ErrorParser(result.error()) << "\n";
+}
+
+std::expected<std::string, Error::ErrorCode> AWSManager::UploadFile(const S3Location& location, std::string_view key, const std::filesystem::path& path, std::uint64_t fileSize)
+{
+	const std::string_view dstBucket{ location.bucket };
+
+	if (syncOptions.chunk && fileSize >= syncOptions.chunkThreshold)
+		return UploadChunked(location, key, path, fileSize);
+
+	if (syncOptions.compress) {
+		auto mappedFile{ MappedFile::Open(path, 0, fileSize) };
+		if (!mappedFile)
+			return std::unexpected(mappedFile.error());
+
+		// Already compressed or random data goes up as is.
+		if (Compression::WorthCompressing(mappedFile.value()->Data(), mappedFile.value()->Size(), syncOptions.compressionLevel))
+			return UploadCompressed(dstBucket, key, path, *mappedFile.value());
+	}
+
+	// The CRT client splits anything over its part size, so it only gets files that would be multipart anyway
+	// and that it splits into more than one part; FileETag expects the classic layout for everything else.
+	if (crt && fileSize >= syncOptions.multipartThreshold && fileSize > Checksum::PartSize(fileSize, syncOptions.partSize))
+		return UploadCrt(dstBucket, key, path, fileSize);
+
+	if (fileSize >= syncOptions.multipartThreshold)
+		return UploadMultipart(dstBucket, key, path, fileSize);
 
-	auto outcome{ GetClient().GetObject(request) };
+	Aws::S3::Model::PutObjectRequest request;
+	request.SetBucket(dstBucket);
+	request.SetKey(key);
+
+	auto body{ OpenBody(path, 0, fileSize) };
+	if (!body)
+		return std::unexpected(body.error());
+
+	request.SetContentLength(static_cast<long long>(fileSize));
+	request.SetBody(std::move(body.value()));
+
+	auto outcome = Transfer(request, fileSize, [&]() { return GetClient().PutObject(request); });
 	if (!outcome.IsSuccess())
-		return std::unexpected(Error::ErrorCode::RetrieveFailed);
+		return std::unexpected(Error::ErrorCode::UploadFailed);
+
+	return outcome.GetResult().GetETag();
+}
+
+std::expected<std::string, Error::ErrorCode> AWSManager::UploadCrt([[maybe_unused]] std::string_view dstBucket, [[maybe_unused]] std::string_view key, [[maybe_unused]] const std::filesystem::path& path, [[maybe_unused]] std::uint64_t fileSize)
+{
+#ifdef S3SYNC_HAVE_CRT
+	Aws::S3Crt::Model::PutObjectRequest request{};
+	request.SetBucket(dstBucket);
+	request.SetKey(key);
+
+	auto body{ OpenBody(path, 0, fileSize) };
+	if (!body)
+		return std::unexpected(body.error());
+
+	request.SetContentLength(static_cast<long long>(fileSize));
+	request.SetBody(std::move(body.value()));
+
+	auto outcome{ Transfer(request, fileSize, [&]() { return crt->client.PutObject(request); }) };
+	if (!outcome.IsSuccess())
+		return std::unexpected(Error::ErrorCode::UploadFailed);
+
+	return outcome.GetResult().GetETag();
+#else
+	return std::unexpected(Error::ErrorCode::UploadFailed);
+#endif
+}
+
+std::expected<std::string, Error::ErrorCode> AWSManager::UploadCompressed(std::string_view dstBucket, std::string_view key, const std::filesystem::path& path, const MappedFile& mappedFile)
+{
+	namespace fs = std::filesystem;
+
+	const std::uint64_t fileSize{ mappedFile.Size() };
+
+	Aws::Map<Aws::String, Aws::String> metadata{};
+	metadata[Aws::String{ Compression::codecKey }] = Aws::String{ Compression::zstdCodec };
+	metadata[Aws::String{ Compression::sizeKey }] = std::to_string(fileSize);
+	// The object's ETag only describes the compressed body, so checksum mode needs the original's.
+	if (syncOptions.compareMode == CompareMode::Checksum) {
+		auto eTag{ Checksum::FileETag(path, fileSize, syncOptions, *pool) };
+		if (eTag)
+			metadata[Aws::String{ Compression::eTagKey }] = eTag.value();
+	}
 
-	std::filesystem::create_directories(tempPath.parent_path());
+	if (fileSize < syncOptions.multipartThreshold) {
+		auto compressed{ Compression::CompressBuffer(mappedFile.Data(), mappedFile.Size(), syncOptions.compressionLevel) };
+		if (!compressed)
+			return std::unexpected(compressed.error());
+
+		Aws::S3::Model::PutObjectRequest request{};
+		request.SetBucket(dstBucket);
+		request.SetKey(key);
+		request.SetMetadata(metadata);
+		const std::uint64_t compressedSize{ compressed->size() };
+		request.SetContentLength(static_cast<long long>(compressedSize));
+		request.SetBody(Aws::MakeShared<Aws::StringStream>("s3-sync", std::move(compressed.value()), std::ios_base::in | std::ios_base::binary));
+
+		auto outcome{ Transfer(request, compressedSize, [&]() { return GetClient().PutObject(request); }) };
+		if (!outcome.IsSuccess())
+			return std::unexpected(Error::ErrorCode::UploadFailed);
+
+		return outcome.GetResult().GetETag();
+	}
 
-	auto& s3Stream{ outcome.GetResult().GetBody() };
-	std::ofstream outputFile(tempPath, std::ios::binary);
-	if (!outputFile.is_open())
+	// Large files are compressed on every core into a temporary file, which then goes up in parts like any other.
+	std::error_code tempError{};
+	const fs::path tempDirectory{ fs::temp_directory_path(tempError) };
+	const auto tempPath{ tempError ? std::nullopt : CreateTempFile(tempDirectory, ".zst") };
+	if (!tempPath)
 		return std::unexpected(Error::ErrorCode::FileSystemError);
 
-	constexpr size_t bufferSize{ 8192 };
-	char buffer[bufferSize];
+	const fs::path& compressedPath{ tempPath.value() };
+	const int threads{ static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)) };
 
-	while (s3Stream.good()) {
-		s3Stream.read(buffer, bufferSize);
-		std::streamsize bytesRead = s3Stream.gcount();
-		outputFile.write(buffer, bytesRead);
+	std::expected<std::string, Error::ErrorCode> result{};
+
+	auto compressed{ Compression::CompressToFile(mappedFile.Data(), mappedFile.Size(), compressedPath, syncOptions.compressionLevel, threads) };
+	if (!compressed)
+		result = std::unexpected(compressed.error());
+	else {
+		std::error_code ec{};
+		const std::uint64_t compressedSize{ fs::file_size(compressedPath, ec) };
+		result = ec ? std::unexpected(Error::ErrorCode::FileSystemError) : UploadMultipart(dstBucket, key, compressedPath, compressedSize, metadata, false);
 	}
 
+	std::error_code ec{};
+	fs::remove(compressedPath, ec);
+
+	return result;
+}
+
+std::optional<ManifestEntry> AWSManager::EncodedOriginal(std::string_view bucket, std::string_view key)
+{
+	// Listings don't carry metadata, so this costs a HEAD per object it's asked about.
+	Aws::S3::Model::HeadObjectRequest request{};
+	request.SetBucket(bucket);
+	request.SetKey(key);
+
+	auto outcome{ Transfer(request, 0, [&]() { return GetClient().HeadObject(request); }) };
+	if (!outcome.IsSuccess())
+		return std::nullopt;
+
+	const auto& metadata{ outcome.GetResult().GetMetadata() };
+	auto codec{ metadata.find(Aws::String{ Compression::codecKey }) };
+	auto size{ metadata.find(Aws::String{ Compression::sizeKey }) };
+	auto eTag{ metadata.find(Aws::String{ Compression::eTagKey }) };
+	if (codec == metadata.end() || size == metadata.end() || eTag == metadata.end())
+		return std::nullopt;
+
+	ManifestEntry original{};
+	const std::string& sizeText{ size->second };
+	auto [end, error] { std::from_chars(sizeText.data(), sizeText.data() + sizeText.size(), original.size) };
+	if (error != std::errc{} || end != sizeText.data() + sizeText.size())
+		return std::nullopt;
+
+	original.eTag = eTag->second;
+	return original;
+}
+
+std::expected<std::string, Error::ErrorCode> AWSManager::UploadChunked(const S3Location& location, std::string_view key, const std::filesystem::path& path, std::uint64_t fileSize)
+{
+	auto mappedFile{ MappedFile::Open(path, 0, fileSize) };
+	if (!mappedFile)
+		return std::unexpected(mappedFile.error());
+
+	const char* data{ mappedFile.value()->Data() };
+
+	ChunkRecipe recipe{ location.KeyFor(Chunking::chunkPrefix), fileSize, syncOptions.chunkSize, Chunking::Split(data, fileSize, syncOptions.chunkSize) };
+
+	auto stored{ StoredChunks(location.bucket, recipe.chunkPrefix) };
+	if (!stored)
+		return std::unexpected(stored.error());
+
+	std::atomic<bool> failed{ false };
+	const std::size_t partConcurrency{ static_cast<std::size_t>(std::max(syncOptions.partConcurrency, 1)) };
+	TransferPool::Group chunks{};
+
+	for (auto& chunk : recipe.chunks) {
+		if (failed)
+			break;
+
+		pool->Wait(chunks, partConcurrency - 1);
+
+		pool->Submit(chunks, [&]() {
+			chunk.hash = Chunking::Hash(data + chunk.offset, chunk.size);
+
+			// Chunks are content-addressed, so one that's already in the bucket never goes up again.
+			{
+				std::lock_guard<std::mutex> lock(storedChunksMutex);
+				if (stored.value()->contains(chunk.hash))
+					return;
+			}
+
+			auto body{ OpenBody(path, chunk.offset, chunk.size) };
+			if (!body) {
+				failed = true;
+				return;
+			}
+
+			Aws::S3::Model::PutObjectRequest request{};
+			request.SetBucket(location.bucket);
+			request.SetKey(recipe.chunkPrefix + chunk.hash);
+			request.SetContentLength(static_cast<long long>(chunk.size));
+			request.SetBody(std::move(body.value()));
+
+			auto outcome{ Transfer(request, chunk.size, [&]() { return GetClient().PutObject(request); }) };
+			if (!outcome.IsSuccess()) {
+				failed = true;
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(storedChunksMutex);
+			stored.value()->insert(chunk.hash);
+		});
+	}
+
+	pool->Wait(chunks);
+
+	if (failed)
+		return std::unexpected(Error::ErrorCode::UploadFailed);
+
+	// The recipe goes up last, so the object never points at a chunk that isn't there yet.
+	Aws::Map<Aws::String, Aws::String> metadata{};
+	metadata[Aws::String{ Compression::codecKey }] = Aws::String{ Chunking::chunksCodec };
+	metadata[Aws::String{ Compression::sizeKey }] = std::to_string(fileSize);
+	if (syncOptions.compareMode == CompareMode::Checksum) {
+		auto eTag{ Checksum::FileETag(path, fileSize, syncOptions, *pool) };
+		if (eTag)
+			metadata[Aws::String{ Compression::eTagKey }] = eTag.value();
+	}
+
+	const std::string serialized{ Chunking::Serialize(recipe) };
+
+	Aws::S3::Model::PutObjectRequest request{};
+	request.SetBucket(location.bucket);
+	request.SetKey(key);
+	request.SetMetadata(metadata);
+	request.SetContentLength(static_cast<long long>(serialized.size()));
+	request.SetBody(Aws::MakeShared<Aws::StringStream>("s3-sync", serialized, std::ios_base::in | std::ios_base::binary));
+
+	auto outcome{ Transfer(request, serialized.size(), [&]() { return GetClient().PutObject(request); }) };
+	if (!outcome.IsSuccess())
+		return std::unexpected(Error::ErrorCode::UploadFailed);
+
+	return outcome.GetResult().GetETag();
+}
+
+std::expected<std::unordered_set<std::string>*, Error::ErrorCode> AWSManager::StoredChunks(std::string_view bucket, std::string_view chunkPrefix)
+{
+	std::string storeKey{ bucket };
+	storeKey += '/';
+	storeKey += chunkPrefix;
+
+	ChunkStore* store{ nullptr };
+	{
+		std::lock_guard<std::mutex> lock(storedChunksMutex);
+		auto& entry{ storedChunks[storeKey] };
+		if (!entry)
+			entry = std::make_unique<ChunkStore>();
+		store = entry.get();
+	}
+
+	// Listed once per run, the first time a file is chunked; uploads add to it from then on.
+	// Only files chunked into the same prefix wait for the listing, the mutex isn't held through it.
+	std::call_once(store->listed, [&]() {
+		std::unordered_set<std::string> hashes{};
+		store->listing = ListObjectPages(bucket, chunkPrefix, {}, [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+			for (const auto& object : page)
+				hashes.emplace(std::string_view(object.GetKey()).substr(chunkPrefix.size()));
+			return true;
+		}, nullptr);
+		store->hashes = std::move(hashes);
+	});
+
+	if (!store->listing)
+		return std::unexpected(store->listing.error());
+
+	return &store->hashes;
+}
+
+std::expected<std::string, Error::ErrorCode> AWSManager::UploadMultipart(std::string_view dstBucket, std::string_view key, const std::filesystem::path& path, std::uint64_t fileSize, const Aws::Map<Aws::String, Aws::String>& metadata, bool resumable)
+{
+	const std::uint64_t partSize{ Checksum::PartSize(fileSize, syncOptions.partSize) };
+	const int partCount{ static_cast<int>((fileSize + partSize - 1) / partSize) };
+
+	auto abortUpload{ [this](std::string_view bucket, std::string_view objectKey, std::string_view uploadId) {
+		// Abort so the uploaded parts don't linger (and get billed) in the bucket.
+		Aws::S3::Model::AbortMultipartUploadRequest abortRequest{};
+		abortRequest.WithBucket(bucket).WithKey(objectKey).WithUploadId(uploadId);
+		Transfer(abortRequest, 0, [&]() { return GetClient().AbortMultipartUpload(abortRequest); });
+	} };
+
+	std::error_code ec{};
+	JournalHeader expected{ std::string(dstBucket), std::string(key), fileSize, BundleIndex::ToUnixTime(std::filesystem::last_write_time(path, ec)), partSize, {} };
+	auto journal{ resumable && !ec ? OpenJournal("upload", path, dstBucket, key) : nullptr };
+
+	Aws::String uploadId{};
+	std::map<std::uint32_t, std::string> uploadedParts{};
+
+	if (journal && journal->Load()) {
+		const JournalHeader previous{ journal->Header() };
+
+		if (SameTransfer(previous, expected) && UploadExists(previous.bucket, previous.key, previous.id) && journal->Continue()) {
+			uploadId = previous.id;
+			uploadedParts = journal->Parts();
+		}
+		else {
+			// The file changed since, or the upload is gone; either way its parts are of no use any more.
+			abortUpload(previous.bucket, previous.key, previous.id);
+			journal->Discard();
+		}
+	}
+
+	if (uploadId.empty()) {
+		Aws::S3::Model::CreateMultipartUploadRequest createRequest{};
+		createRequest.WithBucket(dstBucket).WithKey(key);
+		if (!metadata.empty())
+			createRequest.SetMetadata(metadata);
+
+		auto createOutcome{ Transfer(createRequest, 0, [&]() { return GetClient().CreateMultipartUpload(createRequest); }) };
+		if (!createOutcome.IsSuccess())
+			return std::unexpected(Error::ErrorCode::UploadFailed);
+
+		uploadId = createOutcome.GetResult().GetUploadId();
+
+		expected.id = uploadId;
+		if (journal && !journal->Begin(expected)) {
+			journal->Discard();
+			journal.reset();
+		}
+	}
+
+	Aws::Vector<Aws::S3::Model::CompletedPart> completedParts(partCount);
+	std::atomic<bool> failed{ false };
+
+	const std::size_t partConcurrency{ static_cast<std::size_t>(std::max(syncOptions.partConcurrency, 1)) };
+	TransferPool::Group parts{};
+
+	for (int partIndex = 0; partIndex < partCount && !failed; ++partIndex) {
+		// Parts a previous run already uploaded only need their ETag for the completion request.
+		auto uploaded{ uploadedParts.find(static_cast<std::uint32_t>(partIndex + 1)) };
+		if (uploaded != uploadedParts.end()) {
+			completedParts[partIndex].WithPartNumber(partIndex + 1).WithETag(uploaded->second);
+			continue;
+		}
+
+		// Cap the parts in flight per file so one huge file can't crowd every worker out.
+		pool->Wait(parts, partConcurrency - 1);
+
+		pool->Submit(parts, [&, partIndex]() {
+			const std::uint64_t offset{ partIndex * partSize };
+			const std::uint64_t length{ std::min(partSize, fileSize - offset) };
+
+			// Each part is its own stream over the file, so parts read concurrently without sharing a cursor.
+			auto body{ OpenBody(path, offset, length) };
+			if (!body) {
+				failed = true;
+				return;
+			}
+
+			Aws::S3::Model::UploadPartRequest request{};
+			request.WithBucket(dstBucket)
+				.WithKey(key)
+				.WithUploadId(uploadId)
+				.WithPartNumber(partIndex + 1)
+				.WithContentLength(static_cast<long long>(length));
+			request.SetBody(std::move(body.value()));
+
+			auto outcome{ Transfer(request, length, [&]() { return GetClient().UploadPart(request); }) };
+			if (!outcome.IsSuccess()) {
+				failed = true;
+				return;
+			}
+
+			completedParts[partIndex].WithPartNumber(partIndex + 1).WithETag(outcome.GetResult().GetETag());
+			if (journal)
+				journal->Record(static_cast<std::uint32_t>(partIndex + 1), outcome.GetResult().GetETag());
+		});
+	}
+
+	pool->Wait(parts);
+
+	// With a journal the upload stays open, so the next run only sends the parts that are missing.
+	if (failed && journal)
+		return std::unexpected(Error::ErrorCode::UploadFailed);
+
+	if (!failed) {
+		Aws::S3::Model::CompletedMultipartUpload completedUpload{};
+		completedUpload.SetParts(completedParts);
+
+		Aws::S3::Model::CompleteMultipartUploadRequest completeRequest{};
+		completeRequest.WithBucket(dstBucket)
+			.WithKey(key)
+			.WithUploadId(uploadId)
+			.WithMultipartUpload(completedUpload);
+
+		auto completeOutcome{ Transfer(completeRequest, 0, [&]() { return GetClient().CompleteMultipartUpload(completeRequest); }) };
+		if (completeOutcome.IsSuccess()) {
+			if (journal)
+				journal->Discard();
+
+			return completeOutcome.GetResult().GetETag();
+		}
+	}
+
+	abortUpload(dstBucket, key, uploadId);
+	if (journal)
+		journal->Discard();
+
+	return std::unexpected(Error::ErrorCode::UploadFailed);
+}
+
+std::unique_ptr<TransferJournal> AWSManager::OpenJournal(std::string_view kind, const std::filesystem::path& localPath, std::string_view bucket, std::string_view key)
+{
+	if (!syncOptions.resume || syncOptions.stateDirectory.empty())
+		return nullptr;
+
+	return std::make_unique<TransferJournal>(TransferJournal::PathFor(syncOptions.stateDirectory, kind, localPath, bucket, key));
+}
+
+bool AWSManager::UploadExists(std::string_view bucket, std::string_view key, std::string_view uploadId)
+{
+	// Uploads can be aborted from outside, e.g. by a lifecycle rule, so ask before building on one.
+	Aws::S3::Model::ListPartsRequest request{};
+	request.WithBucket(bucket).WithKey(key).WithUploadId(uploadId).WithMaxParts(1);
+
+	auto outcome{ Transfer(request, 0, [&]() { return GetClient().ListParts(request); }) };
+	return outcome.IsSuccess();
+}
+
+const Metrics& AWSManager::GetMetrics() const
+{
+	return metrics;
+}
+
+Aws::S3::S3Client& AWSManager::GetClient()
+{
+	return *client;
+}
+
+std::expected<RemoteIndex, Error::ErrorCode> AWSManager::IndexObjects(std::string_view bucketName)
+{
+	RemoteIndex objects{};
+	std::mutex objectsMutex{};
+
+	// Each page is folded into the index as it arrives, so the full SDK objects never pile up.
+	auto result{ ForEachObjectPage(S3Location::Parse(bucketName), [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+		std::lock_guard<std::mutex> lock(objectsMutex);
+		objects.Add(page);
+		return true;
+	}) };
+	if (!result)
+		return std::unexpected(result.error());
+
+	return objects;
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::ForEachObjectPage(const S3Location& location, const std::function<bool(const Aws::Vector<Aws::S3::Model::Object>&)>& onPage)
+{
+	const std::string_view bucketName{ location.bucket };
+
+	auto isInternal{ [&](std::string_view key) {
+		return location.RelativeKey(key).starts_with(BundleIndex::internalPrefix);
+	} };
+
+	// Pages only carry what the filter admits; s3-sync's own objects are never filtered out.
+	std::function<bool(const Aws::Vector<Aws::S3::Model::Object>&)> admittedOnPage{ onPage };
+	if (!filter.Empty()) {
+		admittedOnPage = [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+			Aws::Vector<Aws::S3::Model::Object> admitted{};
+			for (const auto& object : page) {
+				if (isInternal(object.GetKey()) || filter.Admits(location.RelativeKey(object.GetKey())))
+					admitted.push_back(object);
+			}
+			return onPage(admitted);
+		};
+	}
+
+	// Includes that start with literal directories only need those listed, along with s3-sync's own prefix.
+	std::vector<std::string> prefixes{};
+	for (const auto& relativePrefix : filter.ListPrefixes())
+		prefixes.push_back(location.KeyFor(relativePrefix));
+	if (prefixes.size() > 1 || prefixes.front() != location.prefix)
+		prefixes.push_back(location.KeyFor(BundleIndex::internalPrefix));
+
+	if (syncOptions.listFanoutDepth == 0 && prefixes.size() == 1)
+		return ListObjectPages(bucketName, prefixes.front(), "", admittedOnPage, nullptr);
+
+	std::atomic<bool> failed{ false };
+	std::atomic<bool> stopped{ false };
+	TransferPool::Group listings{};
+
+	auto guardedOnPage{ [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+		if (stopped)
+			return false;
+		if (!admittedOnPage(page))
+			stopped = true;
+		return !stopped;
+	} };
+
+	// Walk the first levels of "/" prefixes and list every prefix found there on its own worker.
+	std::function<void(std::string, int)> fanOut{ [&](std::string prefix, int depth) {
+		if (depth == 0) {
+			if (!ListObjectPages(bucketName, prefix, "", guardedOnPage, nullptr))
+				failed = true;
+			return;
+		}
+
+		std::vector<std::string> commonPrefixes{};
+		if (!ListObjectPages(bucketName, prefix, "/", guardedOnPage, &commonPrefixes)) {
+			failed = true;
+			return;
+		}
+
+		for (auto& commonPrefix : commonPrefixes) {
+			// Excluded directories are never listed.
+			if (!isInternal(commonPrefix) && !filter.Enters(location.RelativeKey(commonPrefix)))
+				continue;
+
+			pool->Submit(listings, [&fanOut, depth, commonPrefix = std::move(commonPrefix)]() { fanOut(commonPrefix, depth - 1); });
+		}
+	} };
+
+	for (auto& prefix : prefixes)
+		pool->Submit(listings, [&fanOut, prefix = std::move(prefix), depth = syncOptions.listFanoutDepth]() { fanOut(prefix, depth); });
+	pool->Wait(listings);
+
+	if (failed)
+		return std::unexpected(Error::ErrorCode::RetrieveFailed);
+
+	return{};
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::ListObjectPages(std::string_view bucketName, std::string_view prefix, std::string_view delimiter, const std::function<bool(const Aws::Vector<Aws::S3::Model::Object>&)>& onPage, std::vector<std::string>* commonPrefixes)
+{
+	Aws::S3::Model::ListObjectsV2Request request{};
+	request.WithBucket(bucketName);
+	if (!prefix.empty())
+		request.SetPrefix(prefix);
+	if (!delimiter.empty())
+		request.SetDelimiter(delimiter);
+
+	Aws::String continuationToken{};
+
+	do
+	{
+		if (!continuationToken.empty())
+			request.SetContinuationToken(continuationToken);
+
+		auto outcome{ Transfer(request, 0, [&]() { return GetClient().ListObjectsV2(request); }) };
+		if (!outcome.IsSuccess())
+			return std::unexpected(Error::ErrorCode::RetrieveFailed);
+
+		if (commonPrefixes) {
+			for (const auto& commonPrefix : outcome.GetResult().GetCommonPrefixes())
+				commonPrefixes->push_back(commonPrefix.GetPrefix());
+		}
+
+		if (!onPage(outcome.GetResult().GetContents()))
+			break;
+
+		continuationToken = outcome.GetResult().GetNextContinuationToken();
+	} while (!continuationToken.empty());
+
+	return{};
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::ListObjects(std::string_view bucketName)
+{
+	std::cout << bucketName << " Objects:\n";
+
+	// Printed page by page, so listing a huge bucket doesn't hold all of it in memory first.
+	std::mutex coutMutex{};
+	auto result{ ForEachObjectPage(S3Location::Parse(bucketName), [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+		std::lock_guard<std::mutex> lock(coutMutex);
+		for (const auto& object : page) {
+			std::cout << " - " << object.GetKey() << "\n";
+			std::cout << "   " << "Last modified: " << object.GetLastModified().ToGmtString(Aws::Utils::DateFormat::ISO_8601) << "\n";
+		}
+		return true;
+	}) };
+	if (!result)
+		return std::unexpected(Error::ErrorCode::NoObjects);
+
+	return{};
+}
+
+std::expected<int, Error::ErrorCode> AWSManager::get(std::string_view srcBucket, std::string_view dstPath)
+{
+	namespace fs = std::filesystem;
+
+	fs::path p{ dstPath };
+	const S3Location location{ S3Location::Parse(srcBucket) };
+
+	auto manifest{ OpenManifest(p, srcBucket) };
+	// Reconciling runs ignore the manifest and check every local file again.
+	const bool trustManifest{ manifest && !ShouldReconcile(*manifest) };
+
+	TransferPool::Group group{};
+	std::mutex coutMutex{};
+
+	std::atomic<int> fileCount{ 0 };
+
+	auto download{ [&](const Aws::S3::Model::Object& object) {
+		// Keys ending in '/' are folder placeholders, not files.
+		if (object.GetKey().ends_with('/'))
+			return;
+		// Bundles and their index are unpacked separately below.
+		if (location.RelativeKey(object.GetKey()).starts_with(BundleIndex::internalPrefix))
+			return;
+
+		const std::uint64_t objectSize{ static_cast<std::uint64_t>(object.GetSize()) };
+
+		auto localPath{ LocalPathUnder(p, location.RelativeKey(object.GetKey())) };
+		if (!localPath) {
+			metrics.Record(Metrics::Outcome::Failed, objectSize);
+
+			std::lock_guard<std::mutex> lock(coutMutex);
+			std::cerr << "[!] Skipping " << object.GetKey() << ": it would be written outside " << dstPath << "\n";
+			return;
+		}
+		const fs::path tempPath{ std::move(localPath.value()) };
+
+		if (trustManifest) {
+			auto entry{ manifest->Find(object.GetKey()) };
+			if (entry && entry->size == objectSize && entry->eTag == object.GetETag()) {
+				manifest->Touch(object.GetKey());
+				metrics.Record(Metrics::Outcome::Skipped, objectSize);
+				return;
+			}
+		}
+
+		bool shouldDownload{ true };
+
+		std::error_code ec{};
+		if (syncOptions.compareMode == CompareMode::Checksum && fs::is_regular_file(tempPath, ec)) {
+			auto fileSize{ fs::file_size(tempPath, ec) };
+
+			std::optional<ManifestEntry> original{ ManifestEntry{ objectSize, 0, object.GetETag() } };
+			if (!ec && fileSize != objectSize && (syncOptions.compress || syncOptions.chunk))
+				original = EncodedOriginal(location.bucket, object.GetKey());
+
+			if (!ec && original && fileSize == original->size) {
+				auto localETag{ Checksum::FileETag(tempPath, fileSize, syncOptions, *pool) };
+				if (localETag && Checksum::SameETag(localETag.value(), original->eTag)) {
+					shouldDownload = false;
+
+					if (manifest)
+						manifest->Update(object.GetKey(), { fileSize, static_cast<std::int64_t>(fs::last_write_time(tempPath, ec).time_since_epoch().count()), object.GetETag() });
+				}
+			}
+		}
+		else if (fs::is_regular_file(tempPath, ec)) {
+			auto ftime{ fs::last_write_time(tempPath) };
+			auto sctp{ std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+				ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
+			) };
+			std::time_t fileUnixTime{ std::chrono::system_clock::to_time_t(sctp) };
+			std::time_t objectUnixTime{ object.GetLastModified().Seconds() };
+
+			if (fileUnixTime > objectUnixTime) {
+				shouldDownload = false;
+
+				if (manifest)
+					manifest->Update(object.GetKey(), { fs::file_size(tempPath, ec), static_cast<std::int64_t>(ftime.time_since_epoch().count()), object.GetETag() });
+			}
+		}
+
+		if (shouldDownload && syncOptions.dryRun) {
+			std::lock_guard<std::mutex> lock(coutMutex);
+			std::cout << "[dry-run] download " << object.GetKey() << "\n";
+			++fileCount;
+		}
+		else if (shouldDownload) {
+			auto result{ DownloadObjectToPath(
+				location.bucket, object.GetKey(), tempPath, objectSize, object.GetETag()
+			) };
+
+			if (!result) {
+				metrics.Record(Metrics::Outcome::Failed, objectSize);
+
+				std::lock_guard<std::mutex> lock(coutMutex);
+				std::cout << "[!] Failed to download " << location.bucket << "/" << object.GetKey() << "\n";
+				// DownloadFailed
+			}
+			else 
+			{
+				if (manifest)
+					manifest->Update(object.GetKey(), { objectSize, static_cast<std::int64_t>(fs::last_write_time(tempPath, ec).time_since_epoch().count()), object.GetETag() });
+
+				metrics.Record(Metrics::Outcome::Transferred, objectSize);
+				++fileCount;
+			}
+		}
+		else
+			metrics.Record(Metrics::Outcome::Skipped, objectSize);
+	} };
+
+	std::vector<std::string> remotePaths{};
+	std::mutex remotePathsMutex{};
+
+	// Downloads start as soon as each listing page arrives instead of after the whole bucket is listed.
+	auto listing{ ForEachObjectPage(location, [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+		for (const auto& object : page)
+			pool->Submit(group, [&download, object]() { download(object); });
+
+		if (syncOptions.mirror) {
+			std::lock_guard<std::mutex> lock(remotePathsMutex);
+			for (const auto& object : page)
+				remotePaths.emplace_back(location.RelativeKey(object.GetKey()));
+		}
+
+		return true;
+	}) };
+
+	pool->Wait(group);
+
+	if (!listing)
+		return std::unexpected(Error::ErrorCode::NoObjects);
+
+	// Buckets without a bundle index simply have nothing to unpack.
+	auto unbundled{ GetBundles(location, p, syncOptions.mirror ? &remotePaths : nullptr) };
+	if (unbundled)
+		fileCount += unbundled.value();
+	else
+		std::cerr << "[!] Failed to unpack bundles: " << Error::ErrorParser(unbundled.error()) << "\n";
+
+	// Without the bundle index, bundled files can't be told apart from ones the bucket no longer has.
+	if (syncOptions.mirror && unbundled)
+		RemoveExtraneous(p, std::move(remotePaths), location, manifest.get());
+
+	if (manifest)
+		CloseManifest(*manifest);
+
+	return fileCount.load();
+}
+
+std::expected<int, Error::ErrorCode> AWSManager::copy(std::string_view srcBucket, std::string_view dstBucket)
+{
+	const S3Location source{ S3Location::Parse(srcBucket) };
+	const S3Location destination{ S3Location::Parse(dstBucket) };
+
+	RemoteIndex remoteObjects{};
+	auto listing{ IndexObjects(dstBucket) };
+	if (!listing) {
+		if (listing.error() != Error::ErrorCode::NoObjects)
+			return std::unexpected(listing.error());
+	}
+	else
+		remoteObjects = std::move(listing.value());
+
+	TransferPool::Group group{};
+	std::mutex coutMutex{};
+
+	std::atomic<int> objectCount{ 0 };
+
+	std::vector<std::string> sourceKeys{};
+	std::mutex sourceKeysMutex{};
+
+	auto copyObject{ [&](const Aws::S3::Model::Object& object) {
+		// Keys ending in '/' are folder placeholders, not files.
+		if (object.GetKey().ends_with('/'))
+			return;
+
+		const std::string key{ destination.KeyFor(source.RelativeKey(object.GetKey())) };
+		const std::uint64_t objectSize{ static_cast<std::uint64_t>(object.GetSize()) };
+
+		if (auto existing{ remoteObjects.Find(key) }) {
+			// A copy keeps the source's part layout and so its ETag, which makes the checksum comparison exact.
+			const bool unchanged{ syncOptions.compareMode == CompareMode::Checksum
+				? existing->size == objectSize && Checksum::SameETag(existing->eTag, object.GetETag())
+				: object.GetLastModified().Seconds() <= existing->lastModified };
+
+			if (unchanged) {
+				metrics.Record(Metrics::Outcome::Skipped, objectSize);
+				return;
+			}
+		}
+
+		if (syncOptions.dryRun) {
+			std::lock_guard<std::mutex> lock(coutMutex);
+			std::cout << "[dry-run] copy " << source.bucket << "/" << object.GetKey() << " to " << key << "\n";
+			++objectCount;
+			return;
+		}
+
+		auto result{ CopyObjectTo(source, destination, object, key) };
+		if (!result) {
+			metrics.Record(Metrics::Outcome::Failed, objectSize);
+
+			std::lock_guard<std::mutex> lock(coutMutex);
+			std::cerr << "[!] Failed to copy " << source.bucket << "/" << object.GetKey() << "\n";
+		}
+		else {
+			metrics.Record(Metrics::Outcome::Transferred, objectSize);
+			++objectCount;
+		}
+	} };
+
+	// Copies start as soon as each page of the source arrives, like downloads do.
+	auto sourceListing{ ForEachObjectPage(source, [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+		for (const auto& object : page)
+			pool->Submit(group, [&copyObject, object]() { copyObject(object); });
+
+		if (syncOptions.mirror) {
+			std::lock_guard<std::mutex> lock(sourceKeysMutex);
+			for (const auto& object : page)
+				sourceKeys.push_back(destination.KeyFor(source.RelativeKey(object.GetKey())));
+		}
+
+		return true;
+	}) };
+
+	pool->Wait(group);
+
+	if (!sourceListing)
+		return std::unexpected(Error::ErrorCode::RetrieveFailed);
+
+	// Bundles and chunks are copied like any other object, so stale ones in the destination go too.
+	if (syncOptions.mirror)
+		DeleteExtraneous(destination, std::move(sourceKeys), remoteObjects, true);
+
+	return objectCount.load();
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::CopyObjectTo(const S3Location& source, const S3Location& destination, const Aws::S3::Model::Object& object, std::string_view key)
+{
+	// The most a single CopyObject or UploadPartCopy request can copy.
+	constexpr std::uint64_t maxCopySize{ 5ull * 1024 * 1024 * 1024 };
+
+	const std::uint64_t objectSize{ static_cast<std::uint64_t>(object.GetSize()) };
+	const std::string copySource{ CopySource(source.bucket, object.GetKey()) };
+	// Multipart ETags end in "-<part count>".
+	const bool multipart{ object.GetETag().find('-') != std::string::npos };
+	// A chunk recipe names its chunks by full key, so it has to be rewritten when the prefix changes.
+	const bool movesPrefix{ source.prefix != destination.prefix };
+
+	Aws::Map<Aws::String, Aws::String> metadata{};
+	Aws::String contentType{};
+	std::uint64_t partSize{ 0 };
+
+	if (multipart || movesPrefix) {
+		Aws::S3::Model::HeadObjectRequest request{};
+		request.SetBucket(source.bucket);
+		request.SetKey(object.GetKey());
+		request.SetIfMatch(object.GetETag());
+		// Asking for part 1 reports the size the source was uploaded with, and copying with the same parts keeps its ETag.
+		if (multipart)
+			request.SetPartNumber(1);
+
+		auto outcome{ Transfer(request, 0, [&]() { return GetClient().HeadObject(request); }) };
+		if (!outcome.IsSuccess())
+			return std::unexpected(Error::ErrorCode::CopyFailed);
+
+		metadata = outcome.GetResult().GetMetadata();
+		contentType = outcome.GetResult().GetContentType();
+		if (multipart && outcome.GetResult().GetPartsCount() > 0)
+			partSize = static_cast<std::uint64_t>(outcome.GetResult().GetContentLength());
+
+		auto codec{ metadata.find(Aws::String{ Compression::codecKey }) };
+		if (movesPrefix && codec != metadata.end() && codec->second == Chunking::chunksCodec)
+			return CopyRecipe(source, destination, object, key, metadata);
+	}
+
+	if (!multipart && objectSize <= maxCopySize) {
+		Aws::S3::Model::CopyObjectRequest request{};
+		request.SetBucket(destination.bucket);
+		request.SetKey(key);
+		request.SetCopySource(copySource);
+		// Fail instead of copying a newer version than the one that was listed and compared.
+		request.SetCopySourceIfMatch(object.GetETag());
+
+		auto outcome{ Transfer(request, objectSize, [&]() { return GetClient().CopyObject(request); }) };
+		if (!outcome.IsSuccess())
+			return std::unexpected(Error::ErrorCode::CopyFailed);
+
+		return {};
+	}
+
+	// Stores that don't report part sizes, and sources too large for one copy, fall back to the configured part size.
+	if (partSize == 0 || partSize > maxCopySize)
+		partSize = Checksum::PartSize(objectSize, syncOptions.partSize);
+
+	return CopyMultipart(destination.bucket, key, copySource, object.GetETag(), objectSize, partSize, metadata, contentType);
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::CopyMultipart(std::string_view dstBucket, std::string_view key, std::string_view copySource, std::string_view eTag, std::uint64_t objectSize, std::uint64_t partSize, const Aws::Map<Aws::String, Aws::String>& metadata, std::string_view contentType)
+{
+	const int partCount{ static_cast<int>((objectSize + partSize - 1) / partSize) };
+
+	// Multipart copies don't carry the source's metadata over by themselves.
+	Aws::S3::Model::CreateMultipartUploadRequest createRequest{};
+	createRequest.WithBucket(dstBucket).WithKey(key);
+	if (!metadata.empty())
+		createRequest.SetMetadata(metadata);
+	if (!contentType.empty())
+		createRequest.SetContentType(contentType);
+
+	auto createOutcome{ Transfer(createRequest, 0, [&]() { return GetClient().CreateMultipartUpload(createRequest); }) };
+	if (!createOutcome.IsSuccess())
+		return std::unexpected(Error::ErrorCode::CopyFailed);
+
+	const Aws::String uploadId{ createOutcome.GetResult().GetUploadId() };
+
+	Aws::Vector<Aws::S3::Model::CompletedPart> completedParts(partCount);
+	std::atomic<bool> failed{ false };
+
+	const std::size_t partConcurrency{ static_cast<std::size_t>(std::max(syncOptions.partConcurrency, 1)) };
+	TransferPool::Group parts{};
+
+	for (int partIndex = 0; partIndex < partCount && !failed; ++partIndex) {
+		pool->Wait(parts, partConcurrency - 1);
+
+		pool->Submit(parts, [&, partIndex]() {
+			const std::uint64_t first{ partIndex * partSize };
+			const std::uint64_t last{ std::min(first + partSize, objectSize) - 1 };
+
+			Aws::S3::Model::UploadPartCopyRequest request{};
+			request.WithBucket(dstBucket)
+				.WithKey(key)
+				.WithUploadId(uploadId)
+				.WithPartNumber(partIndex + 1)
+				.WithCopySource(copySource)
+				.WithCopySourceRange("bytes=" + std::to_string(first) + "-" + std::to_string(last))
+				.WithCopySourceIfMatch(eTag);
+
+			auto outcome{ Transfer(request, last - first + 1, [&]() { return GetClient().UploadPartCopy(request); }) };
+			if (!outcome.IsSuccess()) {
+				failed = true;
+				return;
+			}
+
+			completedParts[partIndex].WithPartNumber(partIndex + 1).WithETag(outcome.GetResult().GetCopyPartResult().GetETag());
+		});
+	}
+
+	pool->Wait(parts);
+
+	if (!failed) {
+		Aws::S3::Model::CompletedMultipartUpload completedUpload{};
+		completedUpload.SetParts(completedParts);
+
+		Aws::S3::Model::CompleteMultipartUploadRequest completeRequest{};
+		completeRequest.WithBucket(dstBucket)
+			.WithKey(key)
+			.WithUploadId(uploadId)
+			.WithMultipartUpload(completedUpload);
+
+		auto completeOutcome{ Transfer(completeRequest, 0, [&]() { return GetClient().CompleteMultipartUpload(completeRequest); }) };
+		if (completeOutcome.IsSuccess())
+			return {};
+	}
+
+	// Abort so the copied parts don't linger (and get billed) in the bucket.
+	Aws::S3::Model::AbortMultipartUploadRequest abortRequest{};
+	abortRequest.WithBucket(dstBucket).WithKey(key).WithUploadId(uploadId);
+	Transfer(abortRequest, 0, [&]() { return GetClient().AbortMultipartUpload(abortRequest); });
+
+	return std::unexpected(Error::ErrorCode::CopyFailed);
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::CopyRecipe(const S3Location& source, const S3Location& destination, const Aws::S3::Model::Object& object, std::string_view key, const Aws::Map<Aws::String, Aws::String>& metadata)
+{
+	Aws::S3::Model::GetObjectRequest getRequest{};
+	getRequest.SetBucket(source.bucket);
+	getRequest.SetKey(object.GetKey());
+	getRequest.SetIfMatch(object.GetETag());
+
+	auto getOutcome{ Transfer(getRequest, static_cast<std::uint64_t>(object.GetSize()), [&]() { return GetClient().GetObject(getRequest); }) };
+	if (!getOutcome.IsSuccess())
+		return std::unexpected(Error::ErrorCode::CopyFailed);
+
+	auto recipe{ Chunking::Parse(getOutcome.GetResult().GetBody()) };
+	if (!recipe)
+		return std::unexpected(recipe.error());
+
+	// Chunks under the source prefix are copied along with everything else; chunks outside it are left where they are.
+	if (recipe->chunkPrefix.starts_with(source.prefix))
+		recipe->chunkPrefix = destination.prefix + recipe->chunkPrefix.substr(source.prefix.size());
+
+	const std::string serialized{ Chunking::Serialize(recipe.value()) };
+
+	Aws::S3::Model::PutObjectRequest request{};
+	request.SetBucket(destination.bucket);
+	request.SetKey(key);
+	request.SetMetadata(metadata);
+	request.SetContentLength(static_cast<long long>(serialized.size()));
+	request.SetBody(Aws::MakeShared<Aws::StringStream>("s3-sync", serialized, std::ios_base::in | std::ios_base::binary));
+
+	auto outcome{ Transfer(request, serialized.size(), [&]() { return GetClient().PutObject(request); }) };
+	if (!outcome.IsSuccess())
+		return std::unexpected(Error::ErrorCode::CopyFailed);
+
+	return {};
+}
+
+std::expected<std::pair<int, int>, Error::ErrorCode> AWSManager::DeleteAllObjects(std::string_view bucketName)
+{
+	// DeleteObjects accepts at most 1000 keys per request.
+	constexpr std::size_t maxBatchSize{ 1000 };
+
+	const S3Location location{ S3Location::Parse(bucketName) };
+
+	std::atomic<int> deletedObjects{ 0 };
+	int totalObjects{ 0 };
+
+	TransferPool::Group group{};
+
+	auto submitBatch{ [&](Aws::Vector<Aws::S3::Model::ObjectIdentifier> batch) {
+		pool->Submit(group, [&, batch = std::move(batch)]() {
+			const int deleted{ DeleteBatch(location.bucket, batch) };
+			deletedObjects += deleted;
+			metrics.Record(Metrics::Outcome::Transferred, 0, static_cast<std::uint64_t>(deleted));
+			metrics.Record(Metrics::Outcome::Failed, 0, batch.size() - static_cast<std::size_t>(deleted));
+		});
+	} };
+
+	Aws::Vector<Aws::S3::Model::ObjectIdentifier> batch{};
+	batch.reserve(maxBatchSize);
+	std::mutex batchMutex{};
+
+	// Batches go out while later pages are still being listed.
+	auto listing{ ForEachObjectPage(location, [&](const Aws::Vector<Aws::S3::Model::Object>& page) {
+		std::lock_guard<std::mutex> lock(batchMutex);
+		for (const auto& object : page) {
+			// A filtered wipe leaves s3-sync's own objects, which bundled or chunked files it kept still need.
+			if (!filter.Empty() && location.RelativeKey(object.GetKey()).starts_with(BundleIndex::internalPrefix))
+				continue;
+
+			batch.push_back(Aws::S3::Model::ObjectIdentifier{}.WithKey(object.GetKey()));
+			++totalObjects;
+
+			if (batch.size() == maxBatchSize) {
+				submitBatch(std::move(batch));
+				batch = {};
+				batch.reserve(maxBatchSize);
+			}
+		}
+
+		return true;
+	}) };
+
+	if (!batch.empty())
+		submitBatch(std::move(batch));
+
+	pool->Wait(group);
+
+	if (!listing)
+		return std::unexpected(Error::ErrorCode::RetrieveFailed);
+	if (totalObjects == 0)
+		return std::unexpected(Error::ErrorCode::NoObjects);
+
+	return std::make_pair(deletedObjects.load(), totalObjects);
+}
+
+int AWSManager::DeleteBatch(std::string_view bucket, const Aws::Vector<Aws::S3::Model::ObjectIdentifier>& batch)
+{
+	Aws::S3::Model::Delete deletion{};
+	deletion.WithObjects(batch).WithQuiet(true);
+
+	Aws::S3::Model::DeleteObjectsRequest request{};
+	request.WithBucket(bucket).WithDelete(deletion);
+
+	auto outcome{ Transfer(request, 0, [&]() { return GetClient().DeleteObjects(request); }) };
+	if (!outcome.IsSuccess()) {
+		std::cerr << "[!] Failed to delete a batch of " << batch.size() << " objects\n";
+		return 0;
+	}
+
+	// Quiet mode only reports the keys that failed.
+	const auto& errors{ outcome.GetResult().GetErrors() };
+	for (const auto& error : errors)
+		std::cerr << "[!] Failed to delete " << error.GetKey() << ": " << error.GetCode() << "\n";
+
+	return static_cast<int>(batch.size() - errors.size());
+}
+
+int AWSManager::DeleteExtraneous(const S3Location& location, std::vector<std::string> keep, const RemoteIndex& remote, bool includeInternal)
+{
+	// DeleteObjects accepts at most 1000 keys per request.
+	constexpr std::size_t maxBatchSize{ 1000 };
+
+	std::sort(keep.begin(), keep.end());
+
+	TransferPool::Group group{};
+	std::atomic<int> deleted{ 0 };
+	int extraneous{ 0 };
+
+	Aws::Vector<Aws::S3::Model::ObjectIdentifier> batch{};
+
+	auto submitBatch{ [&]() {
+		pool->Submit(group, [&, batch = std::move(batch)]() {
+			deleted += DeleteBatch(location.bucket, batch);
+		});
+		batch = {};
+	} };
+
+	// Both sides are in key order, so one pass over each finds every object the source doesn't have.
+	auto next{ keep.cbegin() };
+	remote.ForEachSorted([&](const RemoteObject& object) {
+		while (next != keep.cend() && std::string_view{ *next } < object.key)
+			++next;
+		if (next != keep.cend() && std::string_view{ *next } == object.key)
+			return;
+
+		if (object.key.ends_with('/'))
+			return;
+		if (!includeInternal && location.RelativeKey(object.key).starts_with(BundleIndex::internalPrefix))
+			return;
+
+		++extraneous;
+		if (syncOptions.dryRun) {
+			std::cout << "[dry-run] delete " << object.key << "\n";
+			return;
+		}
+
+		batch.push_back(Aws::S3::Model::ObjectIdentifier{}.WithKey(Aws::String{ object.key }));
+		if (batch.size() == maxBatchSize)
+			submitBatch();
+	});
+
+	if (!batch.empty())
+		submitBatch();
+
+	pool->Wait(group);
+
+	if (syncOptions.dryRun)
+		std::cout << "Would delete " << extraneous << " objects missing from the source\n";
+	else if (extraneous > 0)
+		std::cout << "Deleted " << deleted << " objects missing from the source\n";
+
+	return syncOptions.dryRun ? extraneous : deleted.load();
+}
+
+int AWSManager::RemoveExtraneous(const std::filesystem::path& root, std::vector<std::string> keep, const S3Location& location, Manifest* manifest)
+{
+	namespace fs = std::filesystem;
+
+	std::vector<std::string> local{};
+	std::mutex localMutex{};
+
+	// Excluded files are never scanned, so they're never deleted either.
+	auto scan{ DirectoryScanner::Scan(root, *pool, [&](ScannedFile scanned) {
+		// Partial downloads are left for the next get to resume.
+		if (scanned.relativePath.ends_with(partialSuffix))
+			return;
+
+		std::lock_guard<std::mutex> lock(localMutex);
+		local.push_back(std::move(scanned.relativePath));
+	}, &filter) };
+	if (!scan && scan.error() == Error::ErrorCode::NoFilePath)
+		return 0;
+
+	std::sort(keep.begin(), keep.end());
+	std::sort(local.begin(), local.end());
+
+	int removed{ 0 };
+	auto next{ keep.cbegin() };
+
+	for (const auto& path : local) {
+		while (next != keep.cend() && *next < path)
+			++next;
+		if (next != keep.cend() && *next == path)
+			continue;
+
+		if (syncOptions.dryRun) {
+			std::cout << "[dry-run] delete " << path << "\n";
+			++removed;
+			continue;
+		}
+
+		std::error_code ec{};
+		if (!fs::remove(root / fs::path(path), ec) || ec) {
+			std::cerr << "[!] Failed to delete " << path << "\n";
+			continue;
+		}
+
+		if (manifest)
+			manifest->Erase(location.KeyFor(path));
+		++removed;
+	}
+
+	if (syncOptions.dryRun)
+		std::cout << "Would delete " << removed << " files missing from the bucket\n";
+	else if (removed > 0)
+		std::cout << "Deleted " << removed << " files missing from the bucket\n";
+
+	return removed;
+}
+
+std::expected<BundleIndex, Error::ErrorCode> AWSManager::FetchBundleIndex(const S3Location& location)
+{
+	Aws::S3::Model::GetObjectRequest request{};
+	request.SetBucket(location.bucket);
+	request.SetKey(location.KeyFor(BundleIndex::indexKey));
+
+	BundleIndex index{};
+
+	auto outcome{ Transfer(request, 0, [&]() { return GetClient().GetObject(request); }) };
+	if (!outcome.IsSuccess()) {
+		// No index yet just means nothing has been bundled under this prefix.
+		if (outcome.GetError().GetResponseCode() == Aws::Http::HttpResponseCode::NOT_FOUND)
+			return index;
+
+		return std::unexpected(Error::ErrorCode::RetrieveFailed);
+	}
+
+	auto parsed{ index.Parse(outcome.GetResult().GetBody()) };
+	if (!parsed)
+		return std::unexpected(parsed.error());
+
+	return index;
+}
+
+std::expected<int, Error::ErrorCode> AWSManager::PutBundles(const S3Location& location, const std::filesystem::path& root, std::vector<ScannedFile> files, bool prune)
+{
+	// DeleteObjects accepts at most 1000 keys per request.
+	constexpr std::size_t maxBatchSize{ 1000 };
+	// Every bundle in flight is held in memory, so only a few are built ahead of the uploads.
+	constexpr std::size_t maxBundlesInFlight{ 4 };
+
+	auto index{ FetchBundleIndex(location) };
+	if (!index)
+		return std::unexpected(index.error());
+
+	const std::set<std::string> previousBundles{ index->ReferencedBundles() };
+
+	// Packing in path order keeps files from the same directory in the same bundle.
+	std::sort(files.begin(), files.end(), [](const ScannedFile& a, const ScannedFile& b) {
+		return a.relativePath < b.relativePath;
+	});
+
+	std::vector<std::string> removed{};
+	if (prune) {
+		for (const auto& [path, entry] : index->Entries()) {
+			// Excluded files were never scanned, and stay bundled.
+			if (!std::ranges::binary_search(files, path, {}, &ScannedFile::relativePath) && filter.Admits(path))
+				removed.push_back(path);
+		}
+	}
+
+	std::erase_if(files, [&](const ScannedFile& file) {
+		const BundleEntry* entry{ index->Find(file.relativePath) };
+		const bool unchanged{ entry && entry->size == file.size && entry->modifiedTime == BundleIndex::ToUnixTime(file.modifiedTime) };
+		if (unchanged)
+			metrics.Record(Metrics::Outcome::Skipped, file.size);
+
+		return unchanged;
+	});
+
+	if (files.empty() && removed.empty())
+		return 0;
+
+	// Bundles whose files have all been repacked elsewhere or removed are no longer referenced and can go.
+	auto staleBundles{ [&]() {
+		const std::set<std::string> currentBundles{ index->ReferencedBundles() };
+
+		std::vector<std::string> stale{};
+		for (const auto& bundle : previousBundles) {
+			if (!currentBundles.contains(bundle))
+				stale.push_back(location.KeyFor(bundle));
+		}
+
+		return stale;
+	} };
+
+	if (syncOptions.dryRun) {
+		for (const auto& file : files)
+			std::cout << "[dry-run] upload " << location.KeyFor(file.relativePath) << " (bundled)\n";
+		for (const auto& path : removed)
+			std::cout << "[dry-run] delete " << location.KeyFor(path) << " (bundled)\n";
+
+		// Changed files would move to new bundles, so they leave their old ones just like removed files do.
+		for (const auto& file : files)
+			index->Erase(file.relativePath);
+		for (const auto& path : removed)
+			index->Erase(path);
+
+		const auto stale{ staleBundles() };
+		for (const auto& key : stale)
+			std::cout << "[dry-run] delete " << key << "\n";
+		if (!stale.empty())
+			std::cout << "Would delete " << stale.size() << " unreferenced bundles\n";
+
+		return static_cast<int>(files.size());
+	}
+
+	// Dropped entries may leave whole bundles unreferenced, which go with the stale ones below.
+	for (const auto& path : removed)
+		index->Erase(path);
+	if (!removed.empty())
+		std::cout << "Deleted " << removed.size() << " bundled files missing from the source\n";
+
+	const std::string runId{ std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()
+	).count()) };
+
+	TransferPool::Group uploads{};
+	std::mutex indexMutex{};
+	std::atomic<int> fileCount{ 0 };
+	std::atomic<bool> failed{ false };
+
+	int bundleNumber{ 0 };
+	std::string bundleName{};
+	std::string buffer{};
+	std::vector<std::pair<std::string, BundleEntry>> bundleEntries{};
+
+	auto submitBundle{ [&]() {
+		if (bundleEntries.empty())
+			return;
+
+		pool->Wait(uploads, maxBundlesInFlight - 1);
+
+		pool->Submit(uploads, [&, name = std::move(bundleName), data = std::move(buffer), entries = std::move(bundleEntries)]() {
+			const std::uint64_t dataSize{ data.size() };
+
+			Aws::S3::Model::PutObjectRequest request{};
+			request.SetBucket(location.bucket);
+			request.SetKey(location.KeyFor(name));
+			request.SetContentLength(static_cast<long long>(dataSize));
+			request.SetBody(Aws::MakeShared<Aws::StringStream>("s3-sync", data, std::ios_base::in | std::ios_base::binary));
+
+			auto outcome{ Transfer(request, dataSize, [&]() { return GetClient().PutObject(request); }) };
+			if (!outcome.IsSuccess()) {
+				failed = true;
+				metrics.Record(Metrics::Outcome::Failed, dataSize, entries.size());
+
+				std::lock_guard<std::mutex> lock(indexMutex);
+				std::cerr << "[!] Failed to upload bundle: " << name << "\n";
+				return;
+			}
+
+			// Entries only move to the new bundle once it's actually in the bucket.
+			std::lock_guard<std::mutex> lock(indexMutex);
+			for (const auto& [path, entry] : entries)
+				index->Update(path, entry);
+
+			fileCount += static_cast<int>(entries.size());
+			metrics.Record(Metrics::Outcome::Transferred, dataSize, entries.size());
+		});
+
+		bundleName = {};
+		buffer = {};
+		bundleEntries = {};
+	} };
+
+	for (const auto& file : files) {
+		if (!bundleEntries.empty() && buffer.size() + file.size > syncOptions.bundleSize)
+			submitBundle();
+
+		if (bundleEntries.empty()) {
+			bundleName = std::string{ BundleIndex::bundlePrefix } + runId + "-" + std::to_string(bundleNumber++) + ".bundle";
+			buffer.reserve(syncOptions.bundleSize);
+		}
+
+		std::ifstream in(root / std::filesystem::path(file.relativePath), std::ios::binary);
+		const std::uint64_t offset{ buffer.size() };
+		buffer.resize(offset + file.size);
+
+		if (!in.is_open() || !in.read(buffer.data() + offset, static_cast<std::streamsize>(file.size))) {
+			buffer.resize(offset);
+			metrics.Record(Metrics::Outcome::Failed, file.size);
+			std::cerr << "[!] Failed to open file: " << file.relativePath << "\n";
+			continue;
+		}
+
+		bundleEntries.emplace_back(file.relativePath, BundleEntry{ bundleName, offset, file.size, BundleIndex::ToUnixTime(file.modifiedTime) });
+	}
+
+	submitBundle();
+	pool->Wait(uploads);
+
+	// The index goes up even after a failed bundle, so the bundles that did land are used.
+	const std::string serialized{ index->Serialize() };
+
+	Aws::S3::Model::PutObjectRequest indexRequest{};
+	indexRequest.SetBucket(location.bucket);
+	indexRequest.SetKey(location.KeyFor(BundleIndex::indexKey));
+	indexRequest.SetContentLength(static_cast<long long>(serialized.size()));
+	indexRequest.SetBody(Aws::MakeShared<Aws::StringStream>("s3-sync", serialized, std::ios_base::in | std::ios_base::binary));
+
+	if (!Transfer(indexRequest, serialized.size(), [&]() { return GetClient().PutObject(indexRequest); }).IsSuccess())
+		return std::unexpected(Error::ErrorCode::UploadFailed);
+
+	const auto stale{ staleBundles() };
+	Aws::Vector<Aws::S3::Model::ObjectIdentifier> batch{};
+	int deleted{ 0 };
+
+	for (const auto& key : stale) {
+		batch.push_back(Aws::S3::Model::ObjectIdentifier{}.WithKey(Aws::String{ key }));
+		if (batch.size() == maxBatchSize) {
+			deleted += DeleteBatch(location.bucket, batch);
+			batch.clear();
+		}
+	}
+
+	if (!batch.empty())
+		deleted += DeleteBatch(location.bucket, batch);
+	if (!stale.empty())
+		std::cout << "Deleted " << deleted << " unreferenced bundles\n";
+
+	return fileCount.load();
+}
+
+std::expected<int, Error::ErrorCode> AWSManager::GetBundles(const S3Location& location, const std::filesystem::path& root, std::vector<std::string>* bundledPaths)
+{
+	namespace fs = std::filesystem;
+
+	auto index{ FetchBundleIndex(location) };
+	if (!index)
+		return std::unexpected(index.error());
+
+	// Group the files that need unpacking by the bundle holding them.
+	std::unordered_map<std::string, std::vector<std::pair<std::string, BundleEntry>>> needed{};
+
+	for (const auto& [path, entry] : index->Entries()) {
+		if (bundledPaths)
+			bundledPaths->push_back(path);
+		if (!filter.Admits(path))
+			continue;
+
+		if (!LocalPathUnder(root, path)) {
+			metrics.Record(Metrics::Outcome::Failed, entry.size);
+			std::cerr << "[!] Skipping bundled " << path << ": it would be written outside " << root.string() << "\n";
+			continue;
+		}
+
+		std::error_code ec{};
+		auto localTime{ fs::last_write_time(root / fs::path(path), ec) };
+		if (!ec && BundleIndex::ToUnixTime(localTime) >= entry.modifiedTime) {
+			metrics.Record(Metrics::Outcome::Skipped, entry.size);
+			continue;
+		}
+
+		needed[entry.bundle].emplace_back(path, entry);
+	}
+
+	if (syncOptions.dryRun) {
+		int fileCount{ 0 };
+		for (const auto& [bundle, entries] : needed) {
+			for (const auto& [path, entry] : entries)
+				std::cout << "[dry-run] download " << location.KeyFor(path) << " (bundled)\n";
+			fileCount += static_cast<int>(entries.size());
+		}
+
+		return fileCount;
+	}
+
+	TransferPool::Group group{};
+	std::mutex coutMutex{};
+	std::atomic<int> fileCount{ 0 };
+
+	for (auto& [bundle, entries] : needed) {
+		pool->Submit(group, [&, bundle, entries = std::move(entries)]() {
+			std::uint64_t first{ std::numeric_limits<std::uint64_t>::max() };
+			std::uint64_t last{ 0 };
+			for (const auto& [path, entry] : entries) {
+				first = std::min(first, entry.offset);
+				last = std::max(last, entry.offset + entry.size);
+			}
+
+			// One GET covers every needed file, which is the whole bundle after a fresh put and a short range otherwise.
+			std::string data{};
+			if (last > first) {
+				Aws::S3::Model::GetObjectRequest request{};
+				request.SetBucket(location.bucket);
+				request.SetKey(location.KeyFor(bundle));
+				request.SetRange("bytes=" + std::to_string(first) + "-" + std::to_string(last - 1));
+
+				auto outcome{ Transfer(request, last - first, [&]() { return GetClient().GetObject(request); }) };
+				if (!outcome.IsSuccess()) {
+					metrics.Record(Metrics::Outcome::Failed, last - first, entries.size());
+
+					std::lock_guard<std::mutex> lock(coutMutex);
+					std::cout << "[!] Failed to download " << location.bucket << "/" << location.KeyFor(bundle) << "\n";
+					return;
+				}
+
+				data.assign(std::istreambuf_iterator<char>(outcome.GetResult().GetBody()), std::istreambuf_iterator<char>());
+				if (data.size() != last - first) {
+					metrics.Record(Metrics::Outcome::Failed, last - first, entries.size());
+
+					std::lock_guard<std::mutex> lock(coutMutex);
+					std::cout << "[!] Truncated bundle " << location.bucket << "/" << location.KeyFor(bundle) << "\n";
+					return;
+				}
+			}
+
+			for (const auto& [path, entry] : entries) {
+				fs::path filePath{ root / fs::path(path) };
+				fs::path partialPath{ filePath };
+				partialPath += partialSuffix;
+
+				std::error_code ec{};
+				fs::create_directories(filePath.parent_path(), ec);
+
+				bool written{ false };
+				{
+					std::ofstream out(partialPath, std::ios::binary | std::ios::trunc);
+					written = out.is_open() && out.write(data.data() + (entry.offset - first), static_cast<std::streamsize>(entry.size));
+				}
+
+				if (written)
+					fs::rename(partialPath, filePath, ec);
+
+				if (!written || ec) {
+					fs::remove(partialPath, ec);
+					metrics.Record(Metrics::Outcome::Failed, entry.size);
+
+					std::lock_guard<std::mutex> lock(coutMutex);
+					std::cout << "[!] Failed to unpack " << path << "\n";
+					continue;
+				}
+
+				// Restore the recorded mtime so the next put and get see the file as unchanged.
+				fs::last_write_time(filePath, BundleIndex::FromUnixTime(entry.modifiedTime), ec);
+				metrics.Record(Metrics::Outcome::Transferred, entry.size);
+				++fileCount;
+			}
+		});
+	}
+
+	pool->Wait(group);
+
+	return fileCount.load();
+}
+
+std::string AWSManager::NormalizePathForS3(const std::filesystem::path& path)
+{
+	return path.generic_string();
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::DownloadObjectToPath(std::string_view srcBucket, std::string_view objectKey, const std::filesystem::path& filePath, std::uint64_t objectSize, std::string_view eTag)
+{
+	namespace fs = std::filesystem;
+
+	fs::path partialPath{ filePath };
+	partialPath += partialSuffix;
+
+	std::error_code ec{};
+	fs::create_directories(filePath.parent_path(), ec);
+	if (ec)
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	std::expected<void, Error::ErrorCode> result{};
+	Aws::Map<Aws::String, Aws::String> metadata{};
+
+	if (crt)
+		result = DownloadCrt(srcBucket, objectKey, partialPath, objectSize, eTag, &metadata);
+	else if (objectSize >= syncOptions.multipartThreshold)
+		result = DownloadRanges(srcBucket, objectKey, partialPath, objectSize, eTag, &metadata);
+	else {
+		Aws::S3::Model::GetObjectRequest request{};
+		request.SetBucket(srcBucket);
+		request.SetKey(objectKey);
+		// Let the SDK write the body straight into the file instead of copying it through a buffer.
+		request.SetResponseStreamFactory([this, partialPath]() {
+			return OpenSink(partialPath, 0, true);
+		});
+
+		auto outcome{ Transfer(request, objectSize, [&]() { return GetClient().GetObject(request); }) };
+		if (!outcome.IsSuccess())
+			result = std::unexpected(Error::ErrorCode::RetrieveFailed);
+		else if (!outcome.GetResult().GetBody().flush())
+			result = std::unexpected(Error::ErrorCode::FileSystemError);
+		else
+			metadata = outcome.GetResult().GetMetadata();
+	}
+
+	auto codec{ metadata.find(Aws::String{ Compression::codecKey }) };
+	if (result && codec != metadata.end()) {
+		fs::path decodedPath{ filePath };
+		decodedPath += ".decoded";
+		decodedPath += partialSuffix;
+
+		// Objects in an unknown codec fail here rather than landing on disk still encoded.
+		std::expected<void, Error::ErrorCode> decoded{ std::unexpected(Error::ErrorCode::CompressionFailed) };
+		if (codec->second == Compression::zstdCodec)
+			decoded = Compression::DecompressFile(partialPath, decodedPath);
+		else if (codec->second == Chunking::chunksCodec)
+			decoded = DownloadChunks(srcBucket, partialPath, filePath, decodedPath);
+
+		fs::remove(partialPath, ec);
+		partialPath = decodedPath;
+
+		if (!decoded)
+			result = std::unexpected(decoded.error());
+	}
+
+	if (result) {
+		fs::rename(partialPath, filePath, ec);
+		if (ec)
+			result = std::unexpected(Error::ErrorCode::FileSystemError);
+	}
+
+	// A ranged download that failed part way keeps its partial file, next to the journal the next run resumes from.
+	const bool resumable{ !result && syncOptions.resume && !syncOptions.stateDirectory.empty()
+		&& fs::exists(TransferJournal::PathFor(syncOptions.stateDirectory, "download", partialPath, srcBucket, objectKey), ec) };
+	if (!result && !resumable)
+		fs::remove(partialPath, ec);
+
+	return result;
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::DownloadCrt([[maybe_unused]] std::string_view srcBucket, [[maybe_unused]] std::string_view objectKey, [[maybe_unused]] const std::filesystem::path& filePath, [[maybe_unused]] std::uint64_t objectSize, [[maybe_unused]] std::string_view eTag, [[maybe_unused]] Aws::Map<Aws::String, Aws::String>* metadata)
+{
+#ifdef S3SYNC_HAVE_CRT
+	Aws::S3Crt::Model::GetObjectRequest request{};
+	request.SetBucket(srcBucket);
+	request.SetKey(objectKey);
+	if (!eTag.empty())
+		request.SetIfMatch(eTag);
+	// Large objects are fetched as parallel ranges inside the CRT client, which hands them to the stream in order.
+	request.SetResponseStreamFactory([this, filePath]() {
+		return OpenSink(filePath, 0, true);
+	});
+
+	auto outcome{ Transfer(request, objectSize, [&]() { return crt->client.GetObject(request); }) };
+	if (!outcome.IsSuccess())
+		return std::unexpected(Error::ErrorCode::RetrieveFailed);
+	if (!outcome.GetResult().GetBody().flush())
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	*metadata = outcome.GetResult().GetMetadata();
+	return {};
+#else
+	return std::unexpected(Error::ErrorCode::RetrieveFailed);
+#endif
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::DownloadRanges(std::string_view srcBucket, std::string_view objectKey, const std::filesystem::path& filePath, std::uint64_t objectSize, std::string_view eTag, Aws::Map<Aws::String, Aws::String>* metadata)
+{
+	// The same floor as uploads, so a small --part-size can't turn a large object into a GET per few bytes.
+	const std::uint64_t rangeSize{ Checksum::PartSize(objectSize, syncOptions.partSize) };
+	const std::uint64_t rangeCount{ (objectSize + rangeSize - 1) / rangeSize };
+
+	// Without an ETag there's no telling whether the object changed in between, so nothing is resumed.
+	auto journal{ eTag.empty() ? nullptr : OpenJournal("download", filePath, srcBucket, objectKey) };
+	const JournalHeader expected{ std::string(srcBucket), std::string(objectKey), objectSize, 0, rangeSize, std::string(eTag) };
+	std::map<std::uint32_t, std::string> downloadedRanges{};
+
+	std::error_code ec{};
+	if (journal && journal->Load() && SameTransfer(journal->Header(), expected)
+		&& std::filesystem::file_size(filePath, ec) == objectSize && !ec && journal->Continue())
+	{
+		downloadedRanges = journal->Parts();
+	}
+	else {
+		if (journal)
+			journal->Discard();
+
+		if (!PreallocateFile(filePath, objectSize))
+			return std::unexpected(Error::ErrorCode::FileSystemError);
+
+		if (journal && !journal->Begin(expected)) {
+			journal->Discard();
+			journal.reset();
+		}
+	}
+
+	// The metadata comes with the first range, so a resumed download that already has it asks for it separately.
+	if (metadata && downloadedRanges.contains(0)) {
+		Aws::S3::Model::HeadObjectRequest request{};
+		request.SetBucket(srcBucket);
+		request.SetKey(objectKey);
+		request.SetIfMatch(eTag);
+
+		auto outcome{ Transfer(request, 0, [&]() { return GetClient().HeadObject(request); }) };
+		if (!outcome.IsSuccess())
+			return std::unexpected(Error::ErrorCode::DownloadFailed);
+
+		*metadata = outcome.GetResult().GetMetadata();
+	}
+
+	std::atomic<bool> failed{ false };
+	const std::size_t rangeConcurrency{ static_cast<std::size_t>(std::max(syncOptions.partConcurrency, 1)) };
+	TransferPool::Group ranges{};
+
+	for (std::uint64_t rangeIndex = 0; rangeIndex < rangeCount && !failed; ++rangeIndex) {
+		if (downloadedRanges.contains(static_cast<std::uint32_t>(rangeIndex)))
+			continue;
+
+		pool->Wait(ranges, rangeConcurrency - 1);
+
+		pool->Submit(ranges, [&, rangeIndex]() {
+			const std::uint64_t first{ rangeIndex * rangeSize };
+			const std::uint64_t last{ std::min(first + rangeSize, objectSize) - 1 };
+
+			Aws::S3::Model::GetObjectRequest request{};
+			request.SetBucket(srcBucket);
+			request.SetKey(objectKey);
+			request.SetRange("bytes=" + std::to_string(first) + "-" + std::to_string(last));
+			// Pin every range to the listed version so a concurrent overwrite can't splice two objects together.
+			if (!eTag.empty())
+				request.SetIfMatch(eTag);
+			request.SetResponseStreamFactory([this, &filePath, first]() {
+				return OpenSink(filePath, first, false);
+			});
+
+			auto outcome{ Transfer(request, last - first + 1, [&]() { return GetClient().GetObject(request); }) };
+			if (!outcome.IsSuccess() || !outcome.GetResult().GetBody().flush()) {
+				failed = true;
+				return;
+			}
+
+			if (rangeIndex == 0 && metadata)
+				*metadata = outcome.GetResult().GetMetadata();
+			// Only recorded once the bytes are flushed, so a resumed run never trusts a range that didn't land.
+			if (journal)
+				journal->Record(static_cast<std::uint32_t>(rangeIndex));
+		});
+	}
+
+	pool->Wait(ranges);
+
+	if (failed)
+		return std::unexpected(Error::ErrorCode::DownloadFailed);
+
+	if (journal)
+		journal->Discard();
+
+	return{};
+}
+
+std::expected<void, Error::ErrorCode> AWSManager::DownloadChunks(std::string_view srcBucket, const std::filesystem::path& recipePath, const std::filesystem::path& localPath, const std::filesystem::path& filePath)
+{
+	namespace fs = std::filesystem;
+
+	std::expected<ChunkRecipe, Error::ErrorCode> recipe{};
+	{
+		std::ifstream in(recipePath, std::ios::binary);
+		recipe = Chunking::Parse(in);
+		if (!recipe)
+			return std::unexpected(recipe.error());
+	}
+
+	if (!PreallocateFile(filePath, recipe->size))
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	const std::size_t partConcurrency{ static_cast<std::size_t>(std::max(syncOptions.partConcurrency, 1)) };
+
+	// The previous version of the file shares most of its chunks with the new one; split it the same way and copy those locally.
+	std::shared_ptr<MappedFile> localFile{};
+	std::unordered_map<std::string, std::uint64_t> localChunks{};
+
+	std::error_code ec{};
+	const std::uint64_t localSize{ fs::is_regular_file(localPath, ec) ? fs::file_size(localPath, ec) : 0 };
+	if (!ec && localSize > 0 && recipe->averageSize > 0) {
+		auto mapped{ MappedFile::Open(localPath, 0, localSize) };
+		if (mapped) {
+			localFile = std::move(mapped.value());
+
+			std::vector<Chunk> chunks{ Chunking::Split(localFile->Data(), localSize, recipe->averageSize) };
+			TransferPool::Group hashes{};
+			for (auto& chunk : chunks) {
+				pool->Wait(hashes, partConcurrency - 1);
+				pool->Submit(hashes, [&]() { chunk.hash = Chunking::Hash(localFile->Data() + chunk.offset, chunk.size); });
+			}
+			pool->Wait(hashes);
+
+			for (const auto& chunk : chunks)
+				localChunks.emplace(chunk.hash, chunk.offset);
+		}
+	}
+
+	std::atomic<bool> failed{ false };
+	TransferPool::Group chunks{};
+
+	for (const auto& chunk : recipe->chunks) {
+		if (failed)
+			break;
+
+		pool->Wait(chunks, partConcurrency - 1);
+
+		pool->Submit(chunks, [&]() {
+			auto local{ localChunks.find(chunk.hash) };
+			if (local != localChunks.end()) {
+				std::ofstream out(filePath, std::ios::in | std::ios::out | std::ios::binary);
+				out.seekp(static_cast<std::streamoff>(chunk.offset));
+				if (!out.write(localFile->Data() + local->second, static_cast<std::streamsize>(chunk.size)) || !out.flush())
+					failed = true;
+				return;
+			}
+
+			Aws::S3::Model::GetObjectRequest request{};
+			request.SetBucket(srcBucket);
+			request.SetKey(recipe->chunkPrefix + chunk.hash);
+			// One byte more than the chunk should have is enough to tell an oversized one, without reading all of it.
+			request.SetRange("bytes=0-" + std::to_string(chunk.size));
+
+			auto outcome{ Transfer(request, chunk.size, [&]() { return GetClient().GetObject(request); }) };
+			if (!outcome.IsSuccess()) {
+				failed = true;
+				return;
+			}
+
+			// Chunks are named by their hash, so one that doesn't match it is checked before it can land in the file.
+			std::string data{};
+			data.assign(std::istreambuf_iterator<char>(outcome.GetResult().GetBody()), std::istreambuf_iterator<char>());
+			if (data.size() != chunk.size || Chunking::Hash(data.data(), data.size()) != chunk.hash) {
+				std::cerr << "[!] Chunk " << recipe->chunkPrefix << chunk.hash << " doesn't match its hash\n";
+				failed = true;
+				return;
+			}
+
+			std::ofstream out(filePath, std::ios::in | std::ios::out | std::ios::binary);
+			out.seekp(static_cast<std::streamoff>(chunk.offset));
+			if (!out.write(data.data(), static_cast<std::streamsize>(data.size())) || !out.flush())
+				failed = true;
+		});
+	}
+
+	pool->Wait(chunks);
+
+	if (failed)
+		return std::unexpected(Error::ErrorCode::DownloadFailed);
+
 	return{};
 }
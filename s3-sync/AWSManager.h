@@ -1,19 +1,42 @@
 #pragma once
 #include "Error.h"
+#include "SyncOptions.h"
+#include "Manifest.h"
+#include "TransferPool.h"
+#include "S3Location.h"
+#include "DirectoryScanner.h"
+#include "BundleIndex.h"
+#include "MappedFile.h"
+#include "ConcurrencyController.h"
+#include "BandwidthLimiter.h"
+#include "Metrics.h"
+#include "TransferJournal.h"
+#include "DirectoryWatcher.h"
+#include "IoEngine.h"
+#include "RemoteIndex.h"
+#include "PathFilter.h"
 
 #include "aws/core/Aws.h"
 #include "aws/core/auth/AWSCredentials.h"
 #include "aws/s3/S3Client.h"
 
 #include <expected>
+#include <memory>
 
 #include <optional>
 #include <vector>
+#include <set>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <string_view>
 #include <filesystem>
 
 #include <utility>
+#include <functional>
+#include <cstdint>
 
 class AWSManager {
 private:
@@ -21,27 +44,87 @@ private:
 	std::optional<Aws::Client::ClientConfiguration> config;
 	std::optional<Aws::Auth::AWSCredentials> credentials;
 	std::unique_ptr<Aws::S3::S3Client> client;
+	// Only set with --engine=crt on builds that have it; whole-object puts and gets go through it instead.
+	struct CrtClient;
+	std::unique_ptr<CrtClient> crt;
+	SyncOptions syncOptions;
+	// Compiled once from the include and exclude patterns, and applied to every scan and listing.
+	PathFilter filter;
+	// Declared before everything that records into it from a thread of its own.
+	Metrics metrics;
+	std::unique_ptr<BandwidthLimiter> bandwidth;
+	std::unique_ptr<ConcurrencyController> controller;
+	// Declared before the pool so its ring outlives every transfer still holding one of its streams.
+	std::unique_ptr<IoEngine> io;
+	std::unique_ptr<TransferPool> pool;
+	// Chunk hashes known to be in the bucket, for one bucket and chunk prefix.
+	struct ChunkStore {
+		std::once_flag listed;
+		std::expected<void, Error::ErrorCode> listing{};
+		std::unordered_set<std::string> hashes;
+	};
+	std::unordered_map<std::string, std::unique_ptr<ChunkStore>> storedChunks;
+	// Guards the map and the hash sets, but not the listing that fills a set.
+	std::mutex storedChunksMutex;
 
 
 public:
-	AWSManager(std::string_view accessKey, std::string_view secretKey, std::string_view region);
+	AWSManager(std::string_view accessKey, std::string_view secretKey, std::string_view region, const SyncOptions& syncOptions = {});
 	~AWSManager();
 	
 	std::expected<std::vector<std::string>, Error::ErrorCode> GetBucketNames();
 	std::expected<void, Error::ErrorCode> ListBuckets();
 	std::expected<int, Error::ErrorCode> put(std::string_view srcFilePath, std::string_view dstBucket);
+	// Uploads changes as they happen until stop is set, with a full sync first and at every reconcile interval.
+	std::expected<int, Error::ErrorCode> watch(std::string_view srcFilePath, std::string_view dstBucket, const std::atomic<bool>& stop);
 
 	Aws::S3::S3Client& GetClient();
+	const Metrics& GetMetrics() const;
 
-	std::expected<std::vector<Aws::S3::Model::Object>, Error::ErrorCode> GetObjects(std::string_view bucketName);
+	std::expected<RemoteIndex, Error::ErrorCode> IndexObjects(std::string_view bucketName);
 	std::expected<void, Error::ErrorCode> ListObjects(std::string_view bucketName);
 	std::expected<int, Error::ErrorCode> get(std::string_view srcBucket, std::string_view dstPath);
+	// Copies new and changed objects from one bucket (or prefix) to another inside S3, without downloading them.
+	std::expected<int, Error::ErrorCode> copy(std::string_view srcBucket, std::string_view dstBucket);
 	std::expected<std::pair<int, int>, Error::ErrorCode> DeleteAllObjects(std::string_view bucketName);
 
 private:
 	// Helper func
+	template<typename Request, typename Call>
+	auto Transfer(Request& request, std::uint64_t bytes, Call call) -> decltype(call());
 	std::expected<std::vector<std::string>, Error::ErrorCode> GetFilePaths(std::string_view rootPath);
+	std::expected<void, Error::ErrorCode> ForEachObjectPage(const S3Location& location, const std::function<bool(const Aws::Vector<Aws::S3::Model::Object>&)>& onPage);
+	std::expected<void, Error::ErrorCode> ListObjectPages(std::string_view bucketName, std::string_view prefix, std::string_view delimiter, const std::function<bool(const Aws::Vector<Aws::S3::Model::Object>&)>& onPage, std::vector<std::string>* commonPrefixes);
 	std::string NormalizePathForS3(const std::filesystem::path& path);
-	std::expected<void, Error::ErrorCode> DownloadObjectToPath(std::string_view srcBucket, const std::filesystem::path& dstPath, std::string_view objectKey);
-	std::vector<std::string> GetRelativeFilePaths(std::string_view rootPath);
+	std::expected<void, Error::ErrorCode> DownloadObjectToPath(std::string_view srcBucket, std::string_view objectKey, const std::filesystem::path& filePath, std::uint64_t objectSize, std::string_view eTag);
+	std::expected<void, Error::ErrorCode> DownloadCrt(std::string_view srcBucket, std::string_view objectKey, const std::filesystem::path& filePath, std::uint64_t objectSize, std::string_view eTag, Aws::Map<Aws::String, Aws::String>* metadata);
+	std::expected<void, Error::ErrorCode> DownloadRanges(std::string_view srcBucket, std::string_view objectKey, const std::filesystem::path& filePath, std::uint64_t objectSize, std::string_view eTag, Aws::Map<Aws::String, Aws::String>* metadata);
+	int UploadChanged(const S3Location& location, const std::filesystem::path& root, const std::set<std::string>& files, Manifest* manifest);
+	std::expected<std::shared_ptr<Aws::IOStream>, Error::ErrorCode> OpenBody(const std::filesystem::path& path, std::uint64_t offset, std::uint64_t length);
+	Aws::IOStream* OpenSink(const std::filesystem::path& path, std::uint64_t offset, bool truncate);
+	std::unique_ptr<Manifest> OpenManifest(const std::filesystem::path& localPath, std::string_view bucket);
+	bool ShouldReconcile(const Manifest& manifest);
+	void CloseManifest(Manifest& manifest);
+	std::expected<std::string, Error::ErrorCode> UploadFile(const S3Location& location, std::string_view key, const std::filesystem::path& path, std::uint64_t fileSize);
+	std::expected<std::string, Error::ErrorCode> UploadMultipart(std::string_view dstBucket, std::string_view key, const std::filesystem::path& path, std::uint64_t fileSize, const Aws::Map<Aws::String, Aws::String>& metadata = {}, bool resumable = true);
+	std::expected<std::string, Error::ErrorCode> UploadCrt(std::string_view dstBucket, std::string_view key, const std::filesystem::path& path, std::uint64_t fileSize);
+	std::expected<std::string, Error::ErrorCode> UploadCompressed(std::string_view dstBucket, std::string_view key, const std::filesystem::path& path, const MappedFile& mappedFile);
+	std::unique_ptr<TransferJournal> OpenJournal(std::string_view kind, const std::filesystem::path& localPath, std::string_view bucket, std::string_view key);
+	bool UploadExists(std::string_view bucket, std::string_view key, std::string_view uploadId);
+	std::expected<std::string, Error::ErrorCode> UploadChunked(const S3Location& location, std::string_view key, const std::filesystem::path& path, std::uint64_t fileSize);
+	std::expected<std::unordered_set<std::string>*, Error::ErrorCode> StoredChunks(std::string_view bucket, std::string_view chunkPrefix);
+	std::expected<void, Error::ErrorCode> DownloadChunks(std::string_view srcBucket, const std::filesystem::path& recipePath, const std::filesystem::path& localPath, const std::filesystem::path& filePath);
+	std::expected<void, Error::ErrorCode> CopyObjectTo(const S3Location& source, const S3Location& destination, const Aws::S3::Model::Object& object, std::string_view key);
+	std::expected<void, Error::ErrorCode> CopyMultipart(std::string_view dstBucket, std::string_view key, std::string_view copySource, std::string_view eTag, std::uint64_t objectSize, std::uint64_t partSize, const Aws::Map<Aws::String, Aws::String>& metadata, std::string_view contentType);
+	std::expected<void, Error::ErrorCode> CopyRecipe(const S3Location& source, const S3Location& destination, const Aws::S3::Model::Object& object, std::string_view key, const Aws::Map<Aws::String, Aws::String>& metadata);
+	std::optional<ManifestEntry> EncodedOriginal(std::string_view bucket, std::string_view key);
+	std::expected<BundleIndex, Error::ErrorCode> FetchBundleIndex(const S3Location& location);
+	// With prune, files is every small file in the tree and index entries for any other path are dropped.
+	std::expected<int, Error::ErrorCode> PutBundles(const S3Location& location, const std::filesystem::path& root, std::vector<ScannedFile> files, bool prune = false);
+	std::expected<int, Error::ErrorCode> GetBundles(const S3Location& location, const std::filesystem::path& root, std::vector<std::string>* bundledPaths = nullptr);
+	int DeleteBatch(std::string_view bucket, const Aws::Vector<Aws::S3::Model::ObjectIdentifier>& batch);
+	// Deletes every listed object whose key isn't in keep, leaving folder placeholders (and s3-sync's own objects unless includeInternal).
+	int DeleteExtraneous(const S3Location& location, std::vector<std::string> keep, const RemoteIndex& remote, bool includeInternal);
+	// Removes every file under root whose relative path isn't in keep.
+	int RemoveExtraneous(const std::filesystem::path& root, std::vector<std::string> keep, const S3Location& location, Manifest* manifest);
 };
\ No newline at end of file
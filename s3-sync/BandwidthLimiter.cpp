@@ -0,0 +1,136 @@
+#include "BandwidthLimiter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace {
+	constexpr std::int64_t mebibyte{ 1024ll * 1024 };
+	// How often the control file is checked for changes.
+	constexpr std::chrono::seconds pollInterval{ 1 };
+	// Seconds of unused bandwidth that can be saved up and spent as a burst.
+	constexpr double burstSeconds{ 0.25 };
+}
+
+TokenBucket::TokenBucket(std::int64_t rate)
+	: rate{ std::max<std::int64_t>(rate, 0) }
+{
+}
+
+TokenBucket::DelayType TokenBucket::ApplyCost(std::int64_t cost)
+{
+	const std::int64_t currentRate{ rate.load(std::memory_order_relaxed) };
+	if (currentRate == 0)
+		return DelayType{ 0 };
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const Clock::time_point now{ Clock::now() };
+	const double elapsed{ std::chrono::duration<double>(now - updated).count() };
+	updated = now;
+
+	tokens = std::min(tokens + elapsed * static_cast<double>(currentRate), static_cast<double>(currentRate) * burstSeconds);
+	// Tokens may go negative; the debt is what the caller has to wait off.
+	tokens -= static_cast<double>(cost);
+
+	if (tokens >= 0.0)
+		return DelayType{ 0 };
+
+	return std::chrono::duration_cast<DelayType>(std::chrono::duration<double>(-tokens / static_cast<double>(currentRate)));
+}
+
+void TokenBucket::ApplyAndPayForCost(std::int64_t cost)
+{
+	const DelayType delay{ ApplyCost(cost) };
+	if (delay.count() > 0)
+		std::this_thread::sleep_for(delay);
+}
+
+void TokenBucket::SetRate(std::int64_t newRate, bool resetAccumulator)
+{
+	rate.store(std::max<std::int64_t>(newRate, 0), std::memory_order_relaxed);
+
+	if (resetAccumulator) {
+		std::lock_guard<std::mutex> lock(mutex);
+		tokens = 0.0;
+		updated = Clock::now();
+	}
+}
+
+std::int64_t TokenBucket::Rate() const
+{
+	return rate.load(std::memory_order_relaxed);
+}
+
+BandwidthLimiter::BandwidthLimiter(std::uint64_t uploadRate, std::uint64_t downloadRate, const std::filesystem::path& controlFile, Metrics& metrics)
+	: upload{ std::make_shared<TokenBucket>(static_cast<std::int64_t>(uploadRate)) },
+	download{ std::make_shared<TokenBucket>(static_cast<std::int64_t>(downloadRate)) },
+	metrics{ metrics }, controlFile{ controlFile }
+{
+	if (controlFile.empty())
+		return;
+
+	Reload();
+
+	watcher = std::jthread([this](std::stop_token stopToken) {
+		while (!stopToken.stop_requested()) {
+			{
+				std::unique_lock<std::mutex> lock(watchMutex);
+				watchWake.wait_for(lock, stopToken, pollInterval, []() { return false; });
+			}
+
+			if (!stopToken.stop_requested())
+				Reload();
+		}
+	});
+}
+
+void BandwidthLimiter::Reload()
+{
+	// Lines of "upload=<MiB/s>" and "download=<MiB/s>"; 0 lifts the cap. Anything else is ignored.
+	std::error_code ec{};
+	const std::filesystem::file_time_type modified{ std::filesystem::last_write_time(controlFile, ec) };
+	if (ec || modified == controlFileTime)
+		return;
+
+	controlFileTime = modified;
+
+	std::ifstream file(controlFile);
+	std::string line{};
+
+	while (std::getline(file, line)) {
+		std::string_view text{ line };
+		auto separator{ text.find('=') };
+		if (separator == std::string_view::npos)
+			continue;
+
+		std::string_view name{ text.substr(0, separator) };
+		std::string_view value{ text.substr(separator + 1) };
+
+		std::int64_t megabytes{ 0 };
+		auto [end, error] { std::from_chars(value.data(), value.data() + value.size(), megabytes) };
+		if (error != std::errc{} || megabytes < 0)
+			continue;
+
+		if (name == "upload")
+			upload->SetRate(megabytes * mebibyte);
+		else if (name == "download")
+			download->SetRate(megabytes * mebibyte);
+	}
+
+	// Reloaded on a background thread while the progress line is being redrawn on the same stream.
+	metrics.Notice("Bandwidth limits: upload " + std::to_string(upload->Rate() / mebibyte) + " MiB/s, download "
+		+ std::to_string(download->Rate() / mebibyte) + " MiB/s (0 = unlimited)");
+}
+
+std::shared_ptr<Aws::Utils::RateLimits::RateLimiterInterface> BandwidthLimiter::UploadLimiter() const
+{
+	return upload;
+}
+
+std::shared_ptr<Aws::Utils::RateLimits::RateLimiterInterface> BandwidthLimiter::DownloadLimiter() const
+{
+	return download;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "Metrics.h"
+
+#include <aws/core/utils/ratelimiter/RateLimiterInterface.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Token bucket shared by every connection of the client. The SDK charges it from the HTTP
+// layer for each chunk it sends or receives, so the cap holds across all transfers and parts.
+class TokenBucket : public Aws::Utils::RateLimits::RateLimiterInterface {
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Bytes per second; 0 means unlimited.
+	std::atomic<std::int64_t> rate;
+	std::mutex mutex;
+	double tokens{ 0.0 };
+	Clock::time_point updated{ Clock::now() };
+
+public:
+	explicit TokenBucket(std::int64_t rate);
+
+	DelayType ApplyCost(std::int64_t cost) override;
+	void ApplyAndPayForCost(std::int64_t cost) override;
+	void SetRate(std::int64_t rate, bool resetAccumulator = false) override;
+
+	std::int64_t Rate() const;
+};
+
+// Upload and download caps, optionally re-read from a control file while a sync runs.
+class BandwidthLimiter {
+private:
+	std::shared_ptr<TokenBucket> upload;
+	std::shared_ptr<TokenBucket> download;
+
+	Metrics& metrics;
+	std::filesystem::path controlFile;
+	std::filesystem::file_time_type controlFileTime{};
+	std::mutex watchMutex;
+	std::condition_variable_any watchWake;
+	std::jthread watcher;
+
+	void Reload();
+
+public:
+	BandwidthLimiter(std::uint64_t uploadRate, std::uint64_t downloadRate, const std::filesystem::path& controlFile, Metrics& metrics);
+
+	std::shared_ptr<Aws::Utils::RateLimits::RateLimiterInterface> UploadLimiter() const;
+	std::shared_ptr<Aws::Utils::RateLimits::RateLimiterInterface> DownloadLimiter() const;
+};
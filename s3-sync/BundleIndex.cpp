@@ -0,0 +1,124 @@
+#include "BundleIndex.h"
+#include "Serialization.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+namespace {
+	constexpr std::array<char, 4> magic{ 'S', '3', 'S', 'B' };
+	constexpr std::uint32_t version{ 1 };
+
+	using Serialization::WriteValue;
+	using Serialization::ReadValue;
+	using Serialization::WriteString;
+	using Serialization::ReadString;
+
+	// Paths are relative with '/' separators; one that could land outside the destination folder is corrupt.
+	bool IsSafePath(std::string_view path)
+	{
+		if (path.empty() || path.find('\\') != std::string_view::npos || std::filesystem::path(path).has_root_path())
+			return false;
+
+		while (!path.empty()) {
+			auto separator{ path.find('/') };
+			if (path.substr(0, separator) == "..")
+				return false;
+			if (separator == std::string_view::npos)
+				break;
+			path.remove_prefix(separator + 1);
+		}
+
+		return true;
+	}
+}
+
+std::int64_t BundleIndex::ToUnixTime(std::filesystem::file_time_type time)
+{
+	auto systemTime{ std::chrono::file_clock::to_sys(time) };
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(systemTime.time_since_epoch()).count();
+}
+
+std::filesystem::file_time_type BundleIndex::FromUnixTime(std::int64_t time)
+{
+	std::chrono::sys_time<std::chrono::nanoseconds> systemTime{ std::chrono::nanoseconds(time) };
+	return std::chrono::time_point_cast<std::filesystem::file_time_type::duration>(std::chrono::file_clock::from_sys(systemTime));
+}
+
+std::expected<void, Error::ErrorCode> BundleIndex::Parse(std::istream& in)
+{
+	entries.clear();
+
+	std::array<char, 4> fileMagic{};
+	std::uint32_t fileVersion{ 0 };
+	std::uint64_t count{ 0 };
+
+	in.read(fileMagic.data(), fileMagic.size());
+	if (!in || fileMagic != magic || !ReadValue(in, fileVersion) || fileVersion != version || !ReadValue(in, count))
+		return std::unexpected(Error::ErrorCode::CorruptBundleIndex);
+
+	// Not reserved up front: the count comes from the bucket, and a corrupt one fails on the short read below.
+	for (std::uint64_t i = 0; i < count; ++i) {
+		std::string path{};
+		BundleEntry entry{};
+
+		if (!ReadString(in, path) || !IsSafePath(path) || !ReadString(in, entry.bundle) || !ReadValue(in, entry.offset)
+			|| !ReadValue(in, entry.size) || !ReadValue(in, entry.modifiedTime))
+		{
+			entries.clear();
+			return std::unexpected(Error::ErrorCode::CorruptBundleIndex);
+		}
+
+		entries.emplace(std::move(path), std::move(entry));
+	}
+
+	return{};
+}
+
+std::string BundleIndex::Serialize() const
+{
+	std::string out{};
+	out.append(magic.data(), magic.size());
+	WriteValue(out, version);
+	WriteValue(out, static_cast<std::uint64_t>(entries.size()));
+
+	for (const auto& [path, entry] : entries) {
+		WriteString(out, path);
+		WriteString(out, entry.bundle);
+		WriteValue(out, entry.offset);
+		WriteValue(out, entry.size);
+		WriteValue(out, entry.modifiedTime);
+	}
+
+	return out;
+}
+
+const BundleEntry* BundleIndex::Find(const std::string& path) const
+{
+	auto it{ entries.find(path) };
+	return it != entries.end() ? &it->second : nullptr;
+}
+
+void BundleIndex::Update(const std::string& path, BundleEntry entry)
+{
+	entries.insert_or_assign(path, std::move(entry));
+}
+
+void BundleIndex::Erase(const std::string& path)
+{
+	entries.erase(path);
+}
+
+std::set<std::string> BundleIndex::ReferencedBundles() const
+{
+	std::set<std::string> bundles{};
+	for (const auto& [path, entry] : entries)
+		bundles.insert(entry.bundle);
+
+	return bundles;
+}
+
+const std::unordered_map<std::string, BundleEntry>& BundleIndex::Entries() const
+{
+	return entries;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Error.h"
+
+#include <expected>
+#include <filesystem>
+#include <istream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+
+// Where a small file lives inside a bundle object.
+struct BundleEntry {
+	// Bundle key relative to the sync prefix.
+	std::string bundle{};
+	std::uint64_t offset{ 0 };
+	std::uint64_t size{ 0 };
+	// Nanoseconds since the Unix epoch, so indexes move between platforms unchanged.
+	std::int64_t modifiedTime{ 0 };
+};
+
+// Index object mapping each bundled file to its bundle, offset, size and mtime.
+class BundleIndex {
+private:
+	std::unordered_map<std::string, BundleEntry> entries;
+
+public:
+	// Everything s3-sync stores for itself lives under this prefix, next to the synced keys.
+	static constexpr std::string_view internalPrefix{ ".s3sync/" };
+	static constexpr std::string_view bundlePrefix{ ".s3sync/bundles/" };
+	static constexpr std::string_view indexKey{ ".s3sync/bundle-index" };
+
+	static std::int64_t ToUnixTime(std::filesystem::file_time_type time);
+	static std::filesystem::file_time_type FromUnixTime(std::int64_t time);
+
+	std::expected<void, Error::ErrorCode> Parse(std::istream& in);
+	std::string Serialize() const;
+
+	const BundleEntry* Find(const std::string& path) const;
+	void Update(const std::string& path, BundleEntry entry);
+	void Erase(const std::string& path);
+	std::set<std::string> ReferencedBundles() const;
+	const std::unordered_map<std::string, BundleEntry>& Entries() const;
+};
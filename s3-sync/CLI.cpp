@@ -7,6 +7,21 @@
 #include <iostream>
 #include <filesystem>
 #include <utility>
+#include <charconv>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+
+namespace {
+	std::atomic<bool> stopRequested{ false };
+
+	// The first Ctrl-C lets watch finish its batch and report; a second one kills it as usual.
+	void RequestStop(int signal)
+	{
+		stopRequested = true;
+		std::signal(signal, SIG_DFL);
+	}
+}
 
 CLI::CLI(int argc, char** argv)
 	: argc{ argc }, argv{ argv }
@@ -88,7 +103,7 @@ std::expected<std::vector<std::string>, Error::ErrorCode> CLI::ReadConfigFile()
 
 void CLI::Setup()
 {
-	if (argc < 2) {
+	if (!ParseOptions() || argc < 2) {
 		InvalidArguments();
 		return;
 	}
@@ -106,7 +121,9 @@ void CLI::Setup()
 		return;
 	}
 
-	AWSManager manager(credentials.value()[1], credentials.value()[2], credentials.value()[3]);
+	syncOptions.stateDirectory = configPath.parent_path();
+
+	AWSManager manager(credentials.value()[1], credentials.value()[2], credentials.value()[3], syncOptions);
 
 	credentials.value().clear();
 
@@ -115,7 +132,41 @@ void CLI::Setup()
 		if (!CheckArgCount(requiredArgCount))
 			return;
 
-		auto result{ manager.put(argv[2], argv[3]) };
+		std::expected<int, Error::ErrorCode> result{};
+		{
+			ProgressLine progress(manager.GetMetrics());
+			result = manager.put(argv[2], argv[3]);
+		}
+
+		Report(manager.GetMetrics(), "put");
+		if (!result.has_value()) {
+			std::cerr << Error::ErrorParser(result.error());
+			return;
+		}
+
+		if (syncOptions.dryRun)
+			std::cout << "Dry run: would upload " << result.value() << " objects\n";
+		else
+			std::cout << "Successfully uploaded " << result.value() << " objects!\n";
+
+		return;
+	}
+
+	if (std::string_view(argv[1]) == "watch") {
+		int requiredArgCount{ 4 };
+		if (!CheckArgCount(requiredArgCount))
+			return;
+
+		std::signal(SIGINT, RequestStop);
+		std::signal(SIGTERM, RequestStop);
+
+		std::expected<int, Error::ErrorCode> result{};
+		{
+			ProgressLine progress(manager.GetMetrics());
+			result = manager.watch(argv[2], argv[3], stopRequested);
+		}
+
+		Report(manager.GetMetrics(), "watch");
 		if (!result.has_value()) {
 			std::cerr << Error::ErrorParser(result.error());
 			return;
@@ -131,13 +182,47 @@ void CLI::Setup()
 		if (!CheckArgCount(requiredArgCount))
 			return;
 
-		auto result{ manager.get(argv[2], argv[3]) };
+		std::expected<int, Error::ErrorCode> result{};
+		{
+			ProgressLine progress(manager.GetMetrics());
+			result = manager.get(argv[2], argv[3]);
+		}
+
+		Report(manager.GetMetrics(), "get");
 		if (!result.has_value()) {
 			std::cerr << Error::ErrorParser(result.error());
 			return;
 		}
 
-		std::cout << "Successfully downloaded " << result.value() << " objects!\n";
+		if (syncOptions.dryRun)
+			std::cout << "Dry run: would download " << result.value() << " objects\n";
+		else
+			std::cout << "Successfully downloaded " << result.value() << " objects!\n";
+
+		return;
+	}
+
+	if (std::string_view(argv[1]) == "copy") {
+		int requiredArgCount{ 4 };
+		if (!CheckArgCount(requiredArgCount))
+			return;
+
+		std::expected<int, Error::ErrorCode> result{};
+		{
+			ProgressLine progress(manager.GetMetrics());
+			result = manager.copy(argv[2], argv[3]);
+		}
+
+		Report(manager.GetMetrics(), "copy");
+		if (!result.has_value()) {
+			std::cerr << Error::ErrorParser(result.error());
+			return;
+		}
+
+		if (syncOptions.dryRun)
+			std::cout << "Dry run: would copy " << result.value() << " objects\n";
+		else
+			std::cout << "Successfully copied " << result.value() << " objects!\n";
 
 		return;
 	}
@@ -176,7 +261,13 @@ void CLI::Setup()
 		if (confirmation != "yes")
 			return;
 
-		auto result{ manager.DeleteAllObjects(argv[2]) };
+		std::expected<std::pair<int, int>, Error::ErrorCode> result{};
+		{
+			ProgressLine progress(manager.GetMetrics());
+			result = manager.DeleteAllObjects(argv[2]);
+		}
+
+		Report(manager.GetMetrics(), "delete");
 		if (!result.has_value()) {
 			std::cerr << Error::ErrorParser(result.error());
 			return;
@@ -201,12 +292,56 @@ void CLI::InvalidArguments()
 	std::cout
 		<< "Proper usage:\n\n"
 		<< "To configure:\n s3-sync configure\n"
-		<< "To upload:\n s3-sync put <SOURCE/FOLDER> <DESTINATION_BUCKET>\n"
-		<< "To download:\n s3-sync get <SOURCE_BUCKET> <DESTINATION_FOLDER>\n"
+		<< "To upload:\n s3-sync put <SOURCE/FOLDER> <DESTINATION_BUCKET[/PREFIX]>\n"
+		<< "To upload changes as they happen:\n s3-sync watch <SOURCE/FOLDER> <DESTINATION_BUCKET[/PREFIX]>\n"
+		<< "To download:\n s3-sync get <SOURCE_BUCKET[/PREFIX]> <DESTINATION_FOLDER>\n"
+		<< "To copy between buckets:\n s3-sync copy <SOURCE_BUCKET[/PREFIX]> <DESTINATION_BUCKET[/PREFIX]>\n"
 		<< "To list buckets:\n s3-sync list -b\n"
-		<< "To list objects:\n s3-sync list -o <SOURCE_BUCKET>\n"
-		<< "To wipe a bucket:\n s3-sync delete <DESTINATION_BUCKET>\n"
-		<< "To view this menu again:\n s3-sync help\n";
+		<< "To list objects:\n s3-sync list -o <SOURCE_BUCKET[/PREFIX]>\n"
+		<< "To wipe a bucket:\n s3-sync delete <DESTINATION_BUCKET[/PREFIX]>\n"
+		<< "To view this menu again:\n s3-sync help\n\n"
+		<< "Options:\n"
+		<< " --workers=<N>                Transfers running in parallel to start with (default 8)\n"
+		<< " --max-workers=<N>            Most transfers the adaptive limit may grow to (default 64)\n"
+		<< " --retries=<N>                Retries for throttled or failed requests (default 5)\n"
+		<< " --list-fanout=<N>            List the first N levels of \"/\" prefixes in parallel (default 0)\n"
+		<< " --multipart-threshold=<MiB>  Transfer files of at least this size in parts (default 64)\n"
+		<< " --part-size=<MiB>            Size of each part or download range (default 16)\n"
+		<< " --part-concurrency=<N>       Parts transferred in parallel per file (default 4)\n"
+		<< " --no-resume                  Start interrupted multipart transfers over instead of resuming them\n"
+		<< " --no-io-uring                Use plain file I/O for transfer bodies instead of io_uring\n"
+		<< " --manifest                   Remember synced files so later runs only touch what changed\n"
+		<< " --reconcile                  Check the manifest against the bucket on this run\n"
+		<< " --reconcile-interval=<N>     Reconcile the manifest every N runs (default 16, 0 = never)\n"
+		<< " --compare=<timestamp|checksum> Decide what to transfer by modification time or by content (default timestamp)\n"
+		<< " --mirror                     Also delete what the source no longer has from the destination\n"
+		<< " --include=<PATTERN>          Only sync paths matching this gitignore-style pattern (repeatable)\n"
+		<< " --exclude=<PATTERN>          Skip paths matching this gitignore-style pattern (repeatable)\n"
+		<< " --exclude-from=<PATH>        Read exclude patterns from a file, one per line like a .gitignore\n"
+		<< " --dry-run                    Print what would be transferred and deleted without doing it\n"
+		<< " --bundle                     Pack small files into bundle objects on put\n"
+		<< " --bundle-threshold=<KiB>     Files below this size are bundled (default 1024)\n"
+		<< " --bundle-size=<MiB>          Target size of each bundle object (default 64)\n"
+		<< " --chunk                      Store large files as deduplicated chunks and upload only changed ones\n"
+		<< " --chunk-threshold=<MiB>      Files of at least this size are chunked (default 64)\n"
+		<< " --chunk-size=<KiB>           Average chunk size (default 1024, at least 64)\n"
+		<< " --compress                   Compress uploads with zstd when it pays off\n"
+		<< " --compress-level=<N>         zstd level from 1 to 19 (default 3)\n"
+		<< " --upload-limit=<MiB/s>       Cap upload bandwidth across all transfers (default 0 = unlimited)\n"
+		<< " --download-limit=<MiB/s>     Cap download bandwidth across all transfers (default 0 = unlimited)\n"
+		<< " --limit-file=<PATH>          Re-read upload=/download= limits from this file while running\n"
+		<< " --report=<PATH>              Write transfer metrics to this file when done\n"
+		<< " --report-format=<json|prometheus> Format of the metrics report (default json)\n"
+		<< " --watch-delay=<ms>           Upload a batch once watched files have been quiet this long (default 500)\n"
+		<< " --watch-reconcile=<s>        Do a full sync this often while watching (default 3600, 0 = never)\n"
+		<< " --endpoint=<URL>             Talk to an S3-compatible endpoint instead of AWS\n"
+		<< " --engine=<classic|crt>       S3 client for whole-object transfers (default classic)\n"
+		<< " --throughput-target=<Gbps>   Throughput the CRT engine sizes its connections for (default 10)\n"
+		<< " --max-connections=<N>        HTTP connections in the pool (default --max-workers)\n"
+		<< " --connect-timeout=<ms>       Time allowed to open a connection (default: SDK's)\n"
+		<< " --request-timeout=<ms>       Time a request may go without receiving data (default: SDK's)\n"
+		<< " --keep-alive-interval=<s>    Seconds between TCP keep-alive probes (default: SDK's)\n"
+		<< " --no-keep-alive              Don't send TCP keep-alive probes on pooled connections\n";
 }
 
 void CLI::HelpMenu()
@@ -215,12 +350,56 @@ void CLI::HelpMenu()
 	std::cout
 		<< "s3-sync usage:\n\n"
 		<< "To configure:\n s3-sync configure\n"
-		<< "To upload:\n s3-sync put <SOURCE/FOLDER> <DESTINATION_BUCKET>\n"
-		<< "To download:\n s3-sync get <SOURCE_BUCKET> <DESTINATION_FOLDER>\n"
+		<< "To upload:\n s3-sync put <SOURCE/FOLDER> <DESTINATION_BUCKET[/PREFIX]>\n"
+		<< "To upload changes as they happen:\n s3-sync watch <SOURCE/FOLDER> <DESTINATION_BUCKET[/PREFIX]>\n"
+		<< "To download:\n s3-sync get <SOURCE_BUCKET[/PREFIX]> <DESTINATION_FOLDER>\n"
+		<< "To copy between buckets:\n s3-sync copy <SOURCE_BUCKET[/PREFIX]> <DESTINATION_BUCKET[/PREFIX]>\n"
 		<< "To list buckets:\n s3-sync list -b\n"
-		<< "To list objects:\n s3-sync list -o <SOURCE_BUCKET>\n"
-		<< "To wipe a bucket:\n s3-sync delete <DESTINATION_BUCKET>\n"
-		<< "To view this menu again:\n s3-sync help\n";
+		<< "To list objects:\n s3-sync list -o <SOURCE_BUCKET[/PREFIX]>\n"
+		<< "To wipe a bucket:\n s3-sync delete <DESTINATION_BUCKET[/PREFIX]>\n"
+		<< "To view this menu again:\n s3-sync help\n\n"
+		<< "Options:\n"
+		<< " --workers=<N>                Transfers running in parallel to start with (default 8)\n"
+		<< " --max-workers=<N>            Most transfers the adaptive limit may grow to (default 64)\n"
+		<< " --retries=<N>                Retries for throttled or failed requests (default 5)\n"
+		<< " --list-fanout=<N>            List the first N levels of \"/\" prefixes in parallel (default 0)\n"
+		<< " --multipart-threshold=<MiB>  Transfer files of at least this size in parts (default 64)\n"
+		<< " --part-size=<MiB>            Size of each part or download range (default 16)\n"
+		<< " --part-concurrency=<N>       Parts transferred in parallel per file (default 4)\n"
+		<< " --no-resume                  Start interrupted multipart transfers over instead of resuming them\n"
+		<< " --no-io-uring                Use plain file I/O for transfer bodies instead of io_uring\n"
+		<< " --manifest                   Remember synced files so later runs only touch what changed\n"
+		<< " --reconcile                  Check the manifest against the bucket on this run\n"
+		<< " --reconcile-interval=<N>     Reconcile the manifest every N runs (default 16, 0 = never)\n"
+		<< " --compare=<timestamp|checksum> Decide what to transfer by modification time or by content (default timestamp)\n"
+		<< " --mirror                     Also delete what the source no longer has from the destination\n"
+		<< " --include=<PATTERN>          Only sync paths matching this gitignore-style pattern (repeatable)\n"
+		<< " --exclude=<PATTERN>          Skip paths matching this gitignore-style pattern (repeatable)\n"
+		<< " --exclude-from=<PATH>        Read exclude patterns from a file, one per line like a .gitignore\n"
+		<< " --dry-run                    Print what would be transferred and deleted without doing it\n"
+		<< " --bundle                     Pack small files into bundle objects on put\n"
+		<< " --bundle-threshold=<KiB>     Files below this size are bundled (default 1024)\n"
+		<< " --bundle-size=<MiB>          Target size of each bundle object (default 64)\n"
+		<< " --chunk                      Store large files as deduplicated chunks and upload only changed ones\n"
+		<< " --chunk-threshold=<MiB>      Files of at least this size are chunked (default 64)\n"
+		<< " --chunk-size=<KiB>           Average chunk size (default 1024, at least 64)\n"
+		<< " --compress                   Compress uploads with zstd when it pays off\n"
+		<< " --compress-level=<N>         zstd level from 1 to 19 (default 3)\n"
+		<< " --upload-limit=<MiB/s>       Cap upload bandwidth across all transfers (default 0 = unlimited)\n"
+		<< " --download-limit=<MiB/s>     Cap download bandwidth across all transfers (default 0 = unlimited)\n"
+		<< " --limit-file=<PATH>          Re-read upload=/download= limits from this file while running\n"
+		<< " --report=<PATH>              Write transfer metrics to this file when done\n"
+		<< " --report-format=<json|prometheus> Format of the metrics report (default json)\n"
+		<< " --watch-delay=<ms>           Upload a batch once watched files have been quiet this long (default 500)\n"
+		<< " --watch-reconcile=<s>        Do a full sync this often while watching (default 3600, 0 = never)\n"
+		<< " --endpoint=<URL>             Talk to an S3-compatible endpoint instead of AWS\n"
+		<< " --engine=<classic|crt>       S3 client for whole-object transfers (default classic)\n"
+		<< " --throughput-target=<Gbps>   Throughput the CRT engine sizes its connections for (default 10)\n"
+		<< " --max-connections=<N>        HTTP connections in the pool (default --max-workers)\n"
+		<< " --connect-timeout=<ms>       Time allowed to open a connection (default: SDK's)\n"
+		<< " --request-timeout=<ms>       Time a request may go without receiving data (default: SDK's)\n"
+		<< " --keep-alive-interval=<s>    Seconds between TCP keep-alive probes (default: SDK's)\n"
+		<< " --no-keep-alive              Don't send TCP keep-alive probes on pooled connections\n";
 }
 
 std::expected<std::vector<std::string>, Error::ErrorCode> CLI::CheckConfigVector()
@@ -254,3 +433,203 @@ bool CLI::CheckArgCount(int argc)
 
 	return true;
 }
+
+bool CLI::ParseOptions()
+{
+	constexpr std::uint64_t kibibyte{ 1024ull };
+	constexpr std::uint64_t mebibyte{ 1024ull * 1024 };
+
+	for (int i = 0; i < argc; ++i) {
+		std::string_view arg{ argv[i] };
+		if (!arg.starts_with("--")) {
+			args.push_back(argv[i]);
+			continue;
+		}
+
+		auto separator{ arg.find('=') };
+		if (separator == std::string_view::npos) {
+			std::string_view flag{ arg.substr(2) };
+
+			if (flag == "manifest")
+				syncOptions.useManifest = true;
+			else if (flag == "reconcile")
+				syncOptions.useManifest = syncOptions.reconcile = true;
+			else if (flag == "bundle")
+				syncOptions.bundle = true;
+			else if (flag == "compress")
+				syncOptions.compress = true;
+			else if (flag == "chunk")
+				syncOptions.chunk = true;
+			else if (flag == "no-resume")
+				syncOptions.resume = false;
+			else if (flag == "no-io-uring")
+				syncOptions.ioUring = false;
+			else if (flag == "no-keep-alive")
+				syncOptions.tcpKeepAlive = false;
+			else if (flag == "mirror")
+				syncOptions.mirror = true;
+			else if (flag == "dry-run")
+				syncOptions.dryRun = true;
+			else
+				return false;
+
+			continue;
+		}
+
+		std::string_view name{ arg.substr(2, separator - 2) };
+		std::string_view text{ arg.substr(separator + 1) };
+
+		if (name == "endpoint") {
+			syncOptions.endpoint = text;
+			continue;
+		}
+
+		if (name == "report") {
+			reportPath = text;
+			continue;
+		}
+
+		if (name == "report-format") {
+			if (text == "json")
+				reportFormat = ReportFormat::Json;
+			else if (text == "prometheus")
+				reportFormat = ReportFormat::Prometheus;
+			else
+				return false;
+
+			continue;
+		}
+
+		if (name == "limit-file") {
+			syncOptions.limitFile = text;
+			continue;
+		}
+
+		if (name == "include") {
+			syncOptions.includes.emplace_back(text);
+			continue;
+		}
+
+		if (name == "exclude") {
+			syncOptions.excludes.emplace_back(text);
+			continue;
+		}
+
+		// One pattern per line, like a .gitignore; blank lines and '#' comments are skipped.
+		if (name == "exclude-from") {
+			std::ifstream file{ std::string(text) };
+			if (!file.is_open())
+				return false;
+
+			std::string line{};
+			while (std::getline(file, line)) {
+				while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+					line.pop_back();
+				if (!line.empty() && !line.starts_with('#'))
+					syncOptions.excludes.push_back(line);
+			}
+
+			continue;
+		}
+
+		if (name == "engine") {
+			if (text == "classic")
+				syncOptions.engine = Engine::Classic;
+			else if (text == "crt")
+				syncOptions.engine = Engine::Crt;
+			else
+				return false;
+
+			continue;
+		}
+
+		if (name == "compare") {
+			if (text == "timestamp")
+				syncOptions.compareMode = CompareMode::Timestamp;
+			else if (text == "checksum")
+				syncOptions.compareMode = CompareMode::Checksum;
+			else
+				return false;
+
+			continue;
+		}
+
+		auto value{ ParseNumber(text) };
+		if (!value.has_value())
+			return false;
+
+		if (name == "workers" && value.value() > 0)
+			syncOptions.workers = static_cast<int>(value.value());
+		else if (name == "max-workers" && value.value() > 0)
+			syncOptions.maxWorkers = static_cast<int>(value.value());
+		else if (name == "retries")
+			syncOptions.retries = static_cast<int>(std::min<std::uint64_t>(value.value(), 100));
+		else if (name == "list-fanout" && value.value() <= 8)
+			syncOptions.listFanoutDepth = static_cast<int>(value.value());
+		else if (name == "multipart-threshold" && value.value() > 0)
+			syncOptions.multipartThreshold = value.value() * mebibyte;
+		else if (name == "part-size" && value.value() > 0)
+			syncOptions.partSize = value.value() * mebibyte;
+		else if (name == "part-concurrency" && value.value() > 0)
+			syncOptions.partConcurrency = static_cast<int>(value.value());
+		else if (name == "reconcile-interval")
+			syncOptions.reconcileInterval = value.value();
+		else if (name == "upload-limit")
+			syncOptions.uploadLimit = value.value() * mebibyte;
+		else if (name == "download-limit")
+			syncOptions.downloadLimit = value.value() * mebibyte;
+		else if (name == "bundle-threshold")
+			syncOptions.bundleThreshold = value.value() * kibibyte;
+		else if (name == "bundle-size" && value.value() > 0)
+			syncOptions.bundleSize = value.value() * mebibyte;
+		else if (name == "chunk-threshold")
+			syncOptions.chunkThreshold = value.value() * mebibyte;
+		else if (name == "chunk-size" && value.value() >= 64)
+			syncOptions.chunkSize = value.value() * kibibyte;
+		else if (name == "compress-level" && value.value() >= 1 && value.value() <= 19)
+			syncOptions.compressionLevel = static_cast<int>(value.value());
+		else if (name == "watch-delay" && value.value() > 0)
+			syncOptions.watchDelay = std::chrono::milliseconds(value.value());
+		else if (name == "watch-reconcile")
+			syncOptions.watchReconcile = std::chrono::seconds(value.value());
+		else if (name == "throughput-target" && value.value() > 0)
+			syncOptions.throughputTarget = value.value();
+		else if (name == "max-connections" && value.value() > 0)
+			syncOptions.maxConnections = static_cast<int>(std::min<std::uint64_t>(value.value(), 4096));
+		else if (name == "connect-timeout" && value.value() > 0)
+			syncOptions.connectTimeout = std::chrono::milliseconds(value.value());
+		else if (name == "request-timeout" && value.value() > 0)
+			syncOptions.requestTimeout = std::chrono::milliseconds(value.value());
+		else if (name == "keep-alive-interval" && value.value() > 0)
+			syncOptions.keepAliveInterval = std::chrono::seconds(value.value());
+		else
+			return false;
+	}
+
+	argc = static_cast<int>(args.size());
+	argv = args.data();
+
+	return true;
+}
+
+std::optional<std::uint64_t> CLI::ParseNumber(std::string_view value)
+{
+	std::uint64_t number{ 0 };
+	auto [ptr, ec] { std::from_chars(value.data(), value.data() + value.size(), number) };
+	if (ec != std::errc{} || ptr != value.data() + value.size())
+		return std::nullopt;
+
+	return number;
+}
+
+void CLI::Report(const Metrics& metrics, std::string_view operation)
+{
+	std::cout << metrics.Summary() << "\n";
+
+	if (reportPath.empty())
+		return;
+
+	auto result{ metrics.WriteReport(reportPath, reportFormat, operation) };
+	if (!result.has_value())
+		std::cerr << "[!] Failed to write metrics report to " << reportPath << ": " << Error::ErrorParser(result.error()) << "\n";
+}
@@ -1,15 +1,24 @@
 #pragma once
 #include "Error.h"
+#include "SyncOptions.h"
+#include "Metrics.h"
 #include <expected>
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <optional>
+#include <string_view>
+#include <cstdint>
 
 class CLI {
 private:
 	int argc;
 	char** argv;
 	std::filesystem::path configPath;
+	std::vector<char*> args;
+	SyncOptions syncOptions;
+	std::filesystem::path reportPath;
+	ReportFormat reportFormat{ ReportFormat::Json };
 
 public:
 	CLI(int argc, char** argv);
@@ -22,4 +31,7 @@ private:
 	void HelpMenu();
 	std::expected<std::vector<std::string>, Error::ErrorCode> CheckConfigVector();
 	bool CheckArgCount(int argc);
+	bool ParseOptions();
+	std::optional<std::uint64_t> ParseNumber(std::string_view value);
+	void Report(const Metrics& metrics, std::string_view operation);
 };
\ No newline at end of file
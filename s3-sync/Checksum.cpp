@@ -0,0 +1,94 @@
+#include "Checksum.h"
+#include "MappedFile.h"
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+
+#include <aws/core/utils/HashingUtils.h>
+
+namespace {
+	std::string_view StripQuotes(std::string_view eTag)
+	{
+		if (eTag.size() >= 2 && eTag.front() == '"' && eTag.back() == '"')
+			return eTag.substr(1, eTag.size() - 2);
+
+		return eTag;
+	}
+}
+
+std::uint64_t Checksum::PartSize(std::uint64_t fileSize, std::uint64_t requestedPartSize)
+{
+	// S3 caps an upload at 10000 parts of at least 5 MiB, so grow the part size for very large files.
+	constexpr std::uint64_t maxParts{ 10000 };
+	constexpr std::uint64_t minPartSize{ 5ull * 1024 * 1024 };
+
+	std::uint64_t partSize{ std::max(requestedPartSize, minPartSize) };
+	if ((fileSize + partSize - 1) / partSize > maxParts)
+		partSize = (fileSize + maxParts - 1) / maxParts;
+
+	return partSize;
+}
+
+std::expected<std::string, Error::ErrorCode> Checksum::FileETag(const std::filesystem::path& path, std::uint64_t fileSize, const SyncOptions& syncOptions, TransferPool& pool)
+{
+	if (fileSize < syncOptions.multipartThreshold) {
+		auto mappedFile{ MappedFile::Open(path, 0, fileSize) };
+		if (!mappedFile)
+			return std::unexpected(mappedFile.error());
+
+		MappedStream file(std::move(mappedFile.value()));
+		return std::string{ Aws::Utils::HashingUtils::HexEncode(Aws::Utils::HashingUtils::CalculateMD5(file)) };
+	}
+
+	// Multipart ETags are the MD5 of the concatenated part MD5s, so each part can be hashed on its own core.
+	const std::uint64_t partSize{ PartSize(fileSize, syncOptions.partSize) };
+	const std::uint64_t partCount{ (fileSize + partSize - 1) / partSize };
+
+	std::vector<Aws::String> partDigests(partCount);
+	std::atomic<bool> failed{ false };
+
+	// Hashing is CPU-bound, so no more parts are in flight than there are cores.
+	const std::size_t maxInFlight{ std::max<std::size_t>(std::thread::hardware_concurrency(), 1) };
+	TransferPool::Group parts{};
+
+	for (std::uint64_t partIndex = 0; partIndex < partCount && !failed; ++partIndex) {
+		pool.Wait(parts, maxInFlight - 1);
+
+		pool.Submit(parts, [&, partIndex]() {
+			const std::uint64_t offset{ partIndex * partSize };
+			const std::uint64_t length{ std::min(partSize, fileSize - offset) };
+
+			auto mappedPart{ MappedFile::Open(path, offset, length) };
+			if (!mappedPart)
+				failed = true;
+			else {
+				MappedStream part(std::move(mappedPart.value()));
+				auto digest{ Aws::Utils::HashingUtils::CalculateMD5(part) };
+				partDigests[partIndex].assign(reinterpret_cast<const char*>(digest.GetUnderlyingData()), digest.GetLength());
+			}
+		});
+	}
+
+	pool.Wait(parts);
+
+	if (failed)
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+
+	Aws::String concatenated{};
+	concatenated.reserve(partCount * 16);
+	for (const auto& digest : partDigests)
+		concatenated += digest;
+
+	std::string eTag{ Aws::Utils::HashingUtils::HexEncode(Aws::Utils::HashingUtils::CalculateMD5(concatenated)) };
+	eTag += '-';
+	eTag += std::to_string(partCount);
+
+	return eTag;
+}
+
+bool Checksum::SameETag(std::string_view lhs, std::string_view rhs)
+{
+	return StripQuotes(lhs) == StripQuotes(rhs);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "Error.h"
+#include "SyncOptions.h"
+#include "TransferPool.h"
+
+#include <expected>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <cstdint>
+
+namespace Checksum {
+	// Part size S3 ends up using for a multipart upload of a file this big.
+	std::uint64_t PartSize(std::uint64_t fileSize, std::uint64_t requestedPartSize);
+
+	// The ETag S3 would report for this file if it were uploaded with these options; multipart ones hash their parts on the pool.
+	std::expected<std::string, Error::ErrorCode> FileETag(const std::filesystem::path& path, std::uint64_t fileSize, const SyncOptions& syncOptions, TransferPool& pool);
+
+	bool SameETag(std::string_view lhs, std::string_view rhs);
+}
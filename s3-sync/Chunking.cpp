@@ -0,0 +1,162 @@
+#include "Chunking.h"
+#include "Serialization.h"
+
+#include <aws/core/utils/HashingUtils.h>
+#include <aws/core/utils/stream/PreallocatedStreamBuf.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace {
+	constexpr std::array<char, 4> magic{ 'S', '3', 'S', 'C' };
+	constexpr std::uint32_t version{ 1 };
+	constexpr std::size_t hashLength{ 64 };
+
+	// Gear table from a fixed splitmix64 sequence: cut points must come out the same in every build, or nothing dedups.
+	constexpr std::array<std::uint64_t, 256> gear{ []() {
+		std::array<std::uint64_t, 256> table{};
+		std::uint64_t state{ 0x5333796e63434443ull };
+
+		for (auto& value : table) {
+			state += 0x9e3779b97f4a7c15ull;
+			std::uint64_t z{ state };
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+			value = z ^ (z >> 31);
+		}
+
+		return table;
+	}() };
+
+	// The gear hash shifts left, so only its high bits carry enough history to decide a cut.
+	constexpr std::uint64_t HighMask(int bits)
+	{
+		return bits <= 0 ? 0 : ~0ull << (64 - std::min(bits, 63));
+	}
+
+	using Serialization::WriteValue;
+	using Serialization::ReadValue;
+	using Serialization::WriteString;
+	using Serialization::ReadString;
+}
+
+std::vector<Chunk> Chunking::Split(const char* data, std::uint64_t size, std::uint64_t averageSize)
+{
+	const std::uint64_t minSize{ std::max<std::uint64_t>(averageSize / 4, 64) };
+	const std::uint64_t maxSize{ std::max<std::uint64_t>(averageSize * 4, minSize + 1) };
+	const std::uint64_t normalSize{ std::max(averageSize, minSize) };
+
+	// Normalized chunking: a stricter mask before the average size and a looser one after it
+	// keeps most chunks close to the average instead of spread out exponentially.
+	const int bits{ static_cast<int>(std::bit_width(normalSize)) - 1 };
+	const std::uint64_t strictMask{ HighMask(bits + 2) };
+	const std::uint64_t looseMask{ HighMask(bits - 2) };
+
+	const auto* bytes{ reinterpret_cast<const unsigned char*>(data) };
+
+	std::vector<Chunk> chunks{};
+	chunks.reserve(size / normalSize + 1);
+
+	for (std::uint64_t offset = 0; offset < size;) {
+		const std::uint64_t remaining{ size - offset };
+		std::uint64_t length{ remaining };
+
+		if (remaining > minSize) {
+			const std::uint64_t limit{ std::min(remaining, maxSize) };
+			const std::uint64_t normal{ std::min(normalSize, limit) };
+			const unsigned char* window{ bytes + offset };
+
+			std::uint64_t hash{ 0 };
+			std::uint64_t i{ minSize };
+			length = limit;
+
+			// Nothing before the minimum size can be a cut point, so it isn't hashed at all.
+			for (; i < normal; ++i) {
+				hash = (hash << 1) + gear[window[i]];
+				if ((hash & strictMask) == 0) {
+					length = i + 1;
+					break;
+				}
+			}
+
+			if (i == normal) {
+				for (; i < limit; ++i) {
+					hash = (hash << 1) + gear[window[i]];
+					if ((hash & looseMask) == 0) {
+						length = i + 1;
+						break;
+					}
+				}
+			}
+		}
+
+		chunks.push_back(Chunk{ offset, length, {} });
+		offset += length;
+	}
+
+	return chunks;
+}
+
+std::string Chunking::Hash(const char* data, std::uint64_t size)
+{
+	// Hashed straight out of the caller's memory, without copying the chunk into a string first.
+	Aws::Utils::Stream::PreallocatedStreamBuf buffer(reinterpret_cast<unsigned char*>(const_cast<char*>(data)), size);
+	Aws::IOStream stream(&buffer);
+
+	return std::string{ Aws::Utils::HashingUtils::HexEncode(Aws::Utils::HashingUtils::CalculateSHA256(stream)) };
+}
+
+std::string Chunking::Serialize(const ChunkRecipe& recipe)
+{
+	std::string out{};
+	out.reserve(64 + recipe.chunkPrefix.size() + recipe.chunks.size() * (sizeof(std::uint64_t) + hashLength));
+
+	out.append(magic.data(), magic.size());
+	WriteValue(out, version);
+	WriteString(out, recipe.chunkPrefix);
+	WriteValue(out, recipe.size);
+	WriteValue(out, recipe.averageSize);
+	WriteValue(out, static_cast<std::uint64_t>(recipe.chunks.size()));
+
+	for (const auto& chunk : recipe.chunks) {
+		WriteValue(out, chunk.size);
+		out.append(chunk.hash);
+	}
+
+	return out;
+}
+
+std::expected<ChunkRecipe, Error::ErrorCode> Chunking::Parse(std::istream& in)
+{
+	ChunkRecipe recipe{};
+
+	std::array<char, 4> fileMagic{};
+	std::uint32_t fileVersion{ 0 };
+	std::uint64_t count{ 0 };
+
+	in.read(fileMagic.data(), fileMagic.size());
+	if (!in || fileMagic != magic || !ReadValue(in, fileVersion) || fileVersion != version
+		|| !ReadString(in, recipe.chunkPrefix) || !ReadValue(in, recipe.size)
+		|| !ReadValue(in, recipe.averageSize) || !ReadValue(in, count))
+	{
+		return std::unexpected(Error::ErrorCode::CorruptChunkRecipe);
+	}
+
+	std::uint64_t offset{ 0 };
+
+	for (std::uint64_t i = 0; i < count; ++i) {
+		Chunk chunk{ offset, 0, std::string(hashLength, '\0') };
+		if (!ReadValue(in, chunk.size) || !in.read(chunk.hash.data(), hashLength))
+			return std::unexpected(Error::ErrorCode::CorruptChunkRecipe);
+
+		offset += chunk.size;
+		recipe.chunks.push_back(std::move(chunk));
+	}
+
+	// Chunks that don't add up to the file would rebuild it truncated or padded.
+	if (offset != recipe.size)
+		return std::unexpected(Error::ErrorCode::CorruptChunkRecipe);
+
+	return recipe;
+}
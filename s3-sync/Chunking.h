@@ -0,0 +1,42 @@
+#pragma once
+#include "Error.h"
+
+#include <expected>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// One content-defined piece of a file, stored once per bucket prefix under its SHA-256.
+struct Chunk {
+	std::uint64_t offset{ 0 };
+	std::uint64_t size{ 0 };
+	// Lowercase hex SHA-256 of the chunk, which is also its object name.
+	std::string hash{};
+};
+
+// Body of a chunked object: the file's size and the chunks that rebuild it, in order.
+struct ChunkRecipe {
+	// Full key prefix the chunks are stored under, so get doesn't need to know the sync prefix.
+	std::string chunkPrefix{};
+	std::uint64_t size{ 0 };
+	// Average chunk size the file was split with; get splits its local copy the same way to reuse chunks.
+	std::uint64_t averageSize{ 0 };
+	std::vector<Chunk> chunks{};
+};
+
+namespace Chunking {
+	// Relative to the sync prefix, next to the bundles.
+	constexpr std::string_view chunkPrefix{ ".s3sync/chunks/" };
+	// Value of the codec metadata on objects whose body is a recipe rather than the file.
+	constexpr std::string_view chunksCodec{ "chunks" };
+
+	// FastCDC cut points over data, with chunks between averageSize / 4 and averageSize * 4 bytes.
+	// Boundaries depend only on the content around them, so an edit only changes the chunks it touches.
+	std::vector<Chunk> Split(const char* data, std::uint64_t size, std::uint64_t averageSize);
+	std::string Hash(const char* data, std::uint64_t size);
+
+	std::string Serialize(const ChunkRecipe& recipe);
+	std::expected<ChunkRecipe, Error::ErrorCode> Parse(std::istream& in);
+}
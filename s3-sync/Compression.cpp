@@ -0,0 +1,171 @@
+#include "Compression.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#ifdef S3SYNC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+	// Data that doesn't get at least this much smaller is uploaded as is.
+	constexpr double maxCompressedRatio{ 0.9 };
+	constexpr std::size_t sampleSize{ 128 * 1024 };
+	// Below this the metadata costs more than compression saves.
+	constexpr std::size_t minCompressedSize{ 4 * 1024 };
+	// Input handed to the compressor per call, so the worker threads always have a full job queued.
+	constexpr std::size_t inputChunkSize{ 4 * 1024 * 1024 };
+
+#ifdef S3SYNC_HAVE_ZSTD
+	struct CCtxDeleter {
+		void operator()(ZSTD_CCtx* context) const { ZSTD_freeCCtx(context); }
+	};
+
+	struct DCtxDeleter {
+		void operator()(ZSTD_DCtx* context) const { ZSTD_freeDCtx(context); }
+	};
+
+	std::unique_ptr<ZSTD_CCtx, CCtxDeleter> MakeCompressor(int level, int threads)
+	{
+		std::unique_ptr<ZSTD_CCtx, CCtxDeleter> context{ ZSTD_createCCtx() };
+		if (!context)
+			return nullptr;
+
+		ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, level);
+		ZSTD_CCtx_setParameter(context.get(), ZSTD_c_checksumFlag, 1);
+		// Fails harmlessly on a libzstd built without threading, which then compresses on this thread.
+		if (threads > 1)
+			ZSTD_CCtx_setParameter(context.get(), ZSTD_c_nbWorkers, threads);
+
+		return context;
+	}
+#endif
+}
+
+bool Compression::Available()
+{
+#ifdef S3SYNC_HAVE_ZSTD
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Compression::WorthCompressing(const char* data, std::size_t size, int level)
+{
+	if (size < minCompressedSize)
+		return false;
+
+	const std::size_t sample{ std::min(size, sampleSize) };
+	auto compressed{ CompressBuffer(data, sample, level) };
+
+	return compressed && static_cast<double>(compressed->size()) <= static_cast<double>(sample) * maxCompressedRatio;
+}
+
+std::expected<std::string, Error::ErrorCode> Compression::CompressBuffer([[maybe_unused]] const char* data, [[maybe_unused]] std::size_t size, [[maybe_unused]] int level)
+{
+#ifdef S3SYNC_HAVE_ZSTD
+	auto context{ MakeCompressor(level, 1) };
+	if (!context)
+		return std::unexpected(Error::ErrorCode::CompressionFailed);
+
+	std::string compressed(ZSTD_compressBound(size), '\0');
+	const std::size_t written{ ZSTD_compress2(context.get(), compressed.data(), compressed.size(), data, size) };
+	if (ZSTD_isError(written))
+		return std::unexpected(Error::ErrorCode::CompressionFailed);
+
+	compressed.resize(written);
+	return compressed;
+#else
+	return std::unexpected(Error::ErrorCode::CompressionFailed);
+#endif
+}
+
+std::expected<void, Error::ErrorCode> Compression::CompressToFile([[maybe_unused]] const char* data, [[maybe_unused]] std::size_t size, [[maybe_unused]] const std::filesystem::path& destination, [[maybe_unused]] int level, [[maybe_unused]] int threads)
+{
+#ifdef S3SYNC_HAVE_ZSTD
+	auto context{ MakeCompressor(level, threads) };
+	if (!context)
+		return std::unexpected(Error::ErrorCode::CompressionFailed);
+
+	std::ofstream out(destination, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	std::vector<char> buffer(ZSTD_CStreamOutSize());
+	std::size_t consumed{ 0 };
+	bool finished{ false };
+
+	while (!finished) {
+		const std::size_t chunk{ std::min(inputChunkSize, size - consumed) };
+		const bool lastChunk{ consumed + chunk == size };
+		const ZSTD_EndDirective mode{ lastChunk ? ZSTD_e_end : ZSTD_e_continue };
+
+		ZSTD_inBuffer input{ data + consumed, chunk, 0 };
+		do {
+			ZSTD_outBuffer output{ buffer.data(), buffer.size(), 0 };
+			const std::size_t remaining{ ZSTD_compressStream2(context.get(), &output, &input, mode) };
+			if (ZSTD_isError(remaining))
+				return std::unexpected(Error::ErrorCode::CompressionFailed);
+
+			if (!out.write(buffer.data(), static_cast<std::streamsize>(output.pos)))
+				return std::unexpected(Error::ErrorCode::FileSystemError);
+
+			// With ZSTD_e_end the frame is complete once nothing is left to flush.
+			finished = lastChunk && remaining == 0;
+		} while (lastChunk ? !finished : input.pos != input.size);
+
+		consumed += chunk;
+	}
+
+	if (!out.flush())
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	return{};
+#else
+	return std::unexpected(Error::ErrorCode::CompressionFailed);
+#endif
+}
+
+std::expected<void, Error::ErrorCode> Compression::DecompressFile([[maybe_unused]] const std::filesystem::path& source, [[maybe_unused]] const std::filesystem::path& destination)
+{
+#ifdef S3SYNC_HAVE_ZSTD
+	std::unique_ptr<ZSTD_DCtx, DCtxDeleter> context{ ZSTD_createDCtx() };
+	if (!context)
+		return std::unexpected(Error::ErrorCode::CompressionFailed);
+
+	std::ifstream in(source, std::ios::binary);
+	std::ofstream out(destination, std::ios::binary | std::ios::trunc);
+	if (!in.is_open() || !out.is_open())
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	std::vector<char> inputBuffer(ZSTD_DStreamInSize());
+	std::vector<char> outputBuffer(ZSTD_DStreamOutSize());
+	std::size_t lastResult{ 0 };
+
+	while (in) {
+		in.read(inputBuffer.data(), static_cast<std::streamsize>(inputBuffer.size()));
+		ZSTD_inBuffer input{ inputBuffer.data(), static_cast<std::size_t>(in.gcount()), 0 };
+
+		while (input.pos < input.size) {
+			ZSTD_outBuffer output{ outputBuffer.data(), outputBuffer.size(), 0 };
+			lastResult = ZSTD_decompressStream(context.get(), &output, &input);
+			if (ZSTD_isError(lastResult))
+				return std::unexpected(Error::ErrorCode::CompressionFailed);
+
+			if (!out.write(outputBuffer.data(), static_cast<std::streamsize>(output.pos)))
+				return std::unexpected(Error::ErrorCode::FileSystemError);
+		}
+	}
+
+	// A non-zero result means the body ended in the middle of a frame.
+	if (lastResult != 0 || !out.flush())
+		return std::unexpected(Error::ErrorCode::CompressionFailed);
+
+	return{};
+#else
+	return std::unexpected(Error::ErrorCode::CompressionFailed);
+#endif
+}
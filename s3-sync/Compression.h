@@ -0,0 +1,27 @@
+#pragma once
+#include "Error.h"
+
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace Compression {
+	// Object metadata written next to a compressed body.
+	constexpr std::string_view codecKey{ "s3sync-codec" };
+	constexpr std::string_view sizeKey{ "s3sync-size" };
+	constexpr std::string_view eTagKey{ "s3sync-etag" };
+	constexpr std::string_view zstdCodec{ "zstd" };
+
+	// False when s3-sync was built without zstd.
+	bool Available();
+
+	// Compresses a sample from the start of the data and checks that it shrinks enough to be worth it.
+	bool WorthCompressing(const char* data, std::size_t size, int level);
+
+	std::expected<std::string, Error::ErrorCode> CompressBuffer(const char* data, std::size_t size, int level);
+	// Streams the compressed data into a file, splitting the work across threads.
+	std::expected<void, Error::ErrorCode> CompressToFile(const char* data, std::size_t size, const std::filesystem::path& destination, int level, int threads);
+	std::expected<void, Error::ErrorCode> DecompressFile(const std::filesystem::path& source, const std::filesystem::path& destination);
+}
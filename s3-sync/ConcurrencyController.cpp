@@ -0,0 +1,83 @@
+#include "ConcurrencyController.h"
+
+#include <algorithm>
+
+ConcurrencyController::ConcurrencyController(int initialLimit, int maxLimit)
+	: limit{ std::clamp(initialLimit, 1, std::max(maxLimit, 1)) }, maxLimit{ std::max(maxLimit, 1) }, windowStart{ Clock::now() }
+{
+}
+
+void ConcurrencyController::Acquire()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	available.wait(lock, [this]() { return inFlight < limit; });
+	++inFlight;
+}
+
+void ConcurrencyController::Release(std::uint64_t bytes, Clock::duration latency, Signal signal)
+{
+	const Clock::time_point now{ Clock::now() };
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		--inFlight;
+
+		if (signal == Signal::Throttled) {
+			// Requests sent before the last cut throttle too; only a request started after it says the cut wasn't enough.
+			if (now - latency >= lastDecrease) {
+				limit = std::max(minLimit, limit / 2);
+				lastDecrease = now;
+				bestThroughput = 0.0;
+
+				windowStart = now;
+				windowCompletions = 0;
+				windowBytes = 0;
+				windowLatency = {};
+			}
+		}
+		else if (signal == Signal::Success) {
+			++windowCompletions;
+			windowBytes += bytes;
+			windowLatency += latency;
+
+			if (windowCompletions >= limit)
+				EndWindow(now);
+		}
+	}
+
+	available.notify_all();
+}
+
+void ConcurrencyController::EndWindow(Clock::time_point now)
+{
+	const double seconds{ std::max(std::chrono::duration<double>(now - windowStart).count(), 1e-6) };
+	// Windows of requests without a body (deletes, listings) are measured in requests instead of bytes.
+	const double throughput{ static_cast<double>(windowBytes > 0 ? windowBytes : windowCompletions) / seconds };
+	const Clock::duration averageLatency{ windowLatency / windowCompletions };
+
+	bestLatency = std::min(bestLatency, averageLatency);
+
+	// Past saturation extra requests only queue: latency rises while throughput stays put. Growing
+	// then takes a real gain over the best window so far, not just noise.
+	const bool latencyFlat{ averageLatency * 4 <= bestLatency * 5 };
+	const bool latencyQueued{ averageLatency >= bestLatency * 2 };
+	const bool throughputImproved{ throughput >= bestThroughput * 1.05 };
+
+	if (latencyFlat || throughputImproved)
+		limit = std::min(maxLimit, limit + 1);
+	else if (latencyQueued)
+		limit = std::max(minLimit, limit - 1);
+
+	bestThroughput = std::max(bestThroughput, throughput);
+
+	windowStart = now;
+	windowCompletions = 0;
+	windowBytes = 0;
+	windowLatency = {};
+}
+
+int ConcurrencyController::Limit()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return limit;
+}
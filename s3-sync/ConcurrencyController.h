@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// AIMD limit on S3 requests in flight. The limit grows by one per window (one round of
+// requests at the current limit) while throughput holds up and latency stays near the best
+// seen, and halves when S3 throttles or times out.
+class ConcurrencyController {
+public:
+	enum class Signal {
+		Success,
+		Throttled,
+		Failed
+	};
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	std::mutex mutex;
+	std::condition_variable available;
+
+	int limit;
+	const int minLimit{ 1 };
+	const int maxLimit;
+	int inFlight{ 0 };
+
+	Clock::time_point windowStart;
+	int windowCompletions{ 0 };
+	std::uint64_t windowBytes{ 0 };
+	Clock::duration windowLatency{};
+
+	double bestThroughput{ 0.0 };
+	Clock::duration bestLatency{ Clock::duration::max() };
+	Clock::time_point lastDecrease{};
+
+	void EndWindow(Clock::time_point now);
+
+public:
+	ConcurrencyController(int initialLimit, int maxLimit);
+
+	void Acquire();
+	void Release(std::uint64_t bytes, Clock::duration latency, Signal signal);
+
+	int Limit();
+};
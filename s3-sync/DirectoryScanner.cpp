@@ -0,0 +1,202 @@
+#include "DirectoryScanner.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+	struct ScanState {
+		TransferPool& pool;
+		TransferPool::Group group{};
+		const std::function<void(ScannedFile)>& onFile;
+		const PathFilter* filter{ nullptr };
+		std::atomic<bool> failed{ false };
+#ifdef __linux__
+		int rootFd{ -1 };
+#else
+		std::filesystem::path root{};
+#endif
+	};
+
+	std::string JoinRelative(const std::string& directory, std::string_view name)
+	{
+		std::string path{ directory };
+		if (!path.empty())
+			path += '/';
+		path += name;
+		return path;
+	}
+
+	bool Enters(const ScanState& state, std::string_view directory)
+	{
+		return !state.filter || state.filter->Enters(directory);
+	}
+
+	bool Admits(const ScanState& state, std::string_view path)
+	{
+		return !state.filter || state.filter->Admits(path);
+	}
+
+#ifdef __linux__
+	struct LinuxDirent64 {
+		ino64_t d_ino;
+		off64_t d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[];
+	};
+
+	std::filesystem::file_time_type ToFileTime(const struct timespec& time)
+	{
+		auto sinceEpoch{ std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec) };
+		auto systemTime{ std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(sinceEpoch)) };
+		return std::chrono::time_point_cast<std::filesystem::file_time_type::duration>(std::chrono::file_clock::from_sys(systemTime));
+	}
+
+	void ScanDirectory(ScanState& state, std::string relativeDirectory)
+	{
+		const char* openPath{ relativeDirectory.empty() ? "." : relativeDirectory.c_str() };
+		int fd{ ::openat(state.rootFd, openPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+		if (fd < 0) {
+			state.failed = true;
+			return;
+		}
+
+		// getdents64 hands back a whole buffer of entries per syscall, and fstatat on the
+		// directory fd avoids resolving the full path again for every file.
+		std::vector<char> buffer(64 * 1024);
+
+		while (true) {
+			long bytesRead{ ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size()) };
+			if (bytesRead < 0)
+				state.failed = true;
+			if (bytesRead <= 0)
+				break;
+
+			for (long offset = 0; offset < bytesRead;) {
+				const auto* entry{ reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset) };
+				offset += entry->d_reclen;
+
+				std::string_view name{ entry->d_name };
+				if (name == "." || name == "..")
+					continue;
+
+				std::string path{ JoinRelative(relativeDirectory, name) };
+
+				if (entry->d_type == DT_DIR) {
+					if (Enters(state, path)) {
+						state.pool.Submit(state.group, [&state, path = std::move(path)]() mutable {
+							ScanDirectory(state, std::move(path));
+						});
+					}
+					continue;
+				}
+
+				if (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN)
+					continue;
+				if (entry->d_type != DT_UNKNOWN && !Admits(state, path))
+					continue;
+
+				// Like recursive_directory_iterator: follow links to files, but not to directories.
+				struct stat info {};
+				int flags{ entry->d_type == DT_UNKNOWN ? AT_SYMLINK_NOFOLLOW : 0 };
+				if (::fstatat(fd, entry->d_name, &info, flags) != 0)
+					continue;
+
+				if (entry->d_type == DT_UNKNOWN && S_ISDIR(info.st_mode)) {
+					if (Enters(state, path)) {
+						state.pool.Submit(state.group, [&state, path = std::move(path)]() mutable {
+							ScanDirectory(state, std::move(path));
+						});
+					}
+					continue;
+				}
+				if (entry->d_type == DT_UNKNOWN && !Admits(state, path))
+					continue;
+				if (entry->d_type == DT_UNKNOWN && S_ISLNK(info.st_mode) && ::fstatat(fd, entry->d_name, &info, 0) != 0)
+					continue;
+				if (!S_ISREG(info.st_mode))
+					continue;
+
+				state.onFile(ScannedFile{ std::move(path), static_cast<std::uint64_t>(info.st_size), ToFileTime(info.st_mtim) });
+			}
+		}
+
+		::close(fd);
+	}
+#else
+	void ScanDirectory(ScanState& state, std::string relativeDirectory)
+	{
+		namespace fs = std::filesystem;
+
+		std::error_code ec{};
+		fs::directory_iterator it(state.root / fs::path(relativeDirectory), ec);
+		if (ec) {
+			state.failed = true;
+			return;
+		}
+
+		// On Windows the size and time come from the same FindNextFile call as the name.
+		for (const auto& entry : it) {
+			auto name{ entry.path().filename().generic_string() };
+			std::string path{ JoinRelative(relativeDirectory, name) };
+
+			if (entry.is_directory(ec) && !entry.is_symlink(ec)) {
+				if (Enters(state, path)) {
+					state.pool.Submit(state.group, [&state, path = std::move(path)]() mutable {
+						ScanDirectory(state, std::move(path));
+					});
+				}
+				continue;
+			}
+
+			if (!entry.is_regular_file(ec) || !Admits(state, path))
+				continue;
+
+			auto size{ entry.file_size(ec) };
+			auto modifiedTime{ entry.last_write_time(ec) };
+			if (ec)
+				continue;
+
+			state.onFile(ScannedFile{ std::move(path), size, modifiedTime });
+		}
+	}
+#endif
+}
+
+std::expected<void, Error::ErrorCode> DirectoryScanner::Scan(const std::filesystem::path& root, TransferPool& pool, const std::function<void(ScannedFile)>& onFile, const PathFilter* filter)
+{
+	std::error_code ec{};
+	if (!std::filesystem::is_directory(root, ec))
+		return std::unexpected(Error::ErrorCode::NoFilePath);
+
+	ScanState state{ pool, {}, onFile, filter };
+
+#ifdef __linux__
+	state.rootFd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (state.rootFd < 0)
+		return std::unexpected(Error::ErrorCode::NoFilePath);
+#else
+	state.root = root;
+#endif
+
+	ScanDirectory(state, "");
+	pool.Wait(state.group);
+
+#ifdef __linux__
+	::close(state.rootFd);
+#endif
+
+	if (state.failed)
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	return{};
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "Error.h"
+#include "TransferPool.h"
+#include "PathFilter.h"
+
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <cstdint>
+
+struct ScannedFile {
+	// Relative to the scan root, always with '/' separators.
+	std::string relativePath{};
+	std::uint64_t size{ 0 };
+	std::filesystem::file_time_type modifiedTime{};
+};
+
+namespace DirectoryScanner {
+	// Walks root with every directory listed as its own pool task and hands each regular file
+	// to onFile as soon as it is found. onFile is called from several threads at once.
+	// Directories the filter won't enter are never opened, and files it won't admit are never stat'ed.
+	std::expected<void, Error::ErrorCode> Scan(const std::filesystem::path& root, TransferPool& pool, const std::function<void(ScannedFile)>& onFile, const PathFilter* filter = nullptr);
+}
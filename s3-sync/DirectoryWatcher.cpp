@@ -0,0 +1,164 @@
+#include "DirectoryWatcher.h"
+
+#include <iostream>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+#ifdef __linux__
+	// Close-write instead of modify, so a file is reported once it's written rather than on every write() call.
+	constexpr std::uint32_t watchMask{ IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_ATTRIB | IN_ONLYDIR };
+#endif
+}
+
+DirectoryWatcher::DirectoryWatcher(std::filesystem::path root, const PathFilter* filter)
+	: root{ std::move(root) }, filter{ filter }
+{
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+#ifdef __linux__
+	if (fd >= 0)
+		::close(fd);
+#endif
+}
+
+std::expected<std::unique_ptr<DirectoryWatcher>, Error::ErrorCode> DirectoryWatcher::Open(const std::filesystem::path& root, const PathFilter* filter)
+{
+#ifdef __linux__
+	std::unique_ptr<DirectoryWatcher> watcher{ new DirectoryWatcher(root, filter) };
+
+	watcher->fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watcher->fd < 0)
+		return std::unexpected(Error::ErrorCode::WatchFailed);
+
+	// Files already in the tree are the initial sync's job, not the watcher's.
+	std::set<std::string> existing{};
+	watcher->AddTree({}, existing);
+	if (watcher->directories.empty() || watcher->overflowed)
+		return std::unexpected(Error::ErrorCode::WatchFailed);
+
+	return watcher;
+#else
+	return std::unexpected(Error::ErrorCode::WatchFailed);
+#endif
+}
+
+void DirectoryWatcher::AddTree(const std::string& relativeDirectory, std::set<std::string>& changed)
+{
+#ifdef __linux__
+	namespace fs = std::filesystem;
+
+	// Covers the first walk and directories created later alike.
+	if (!relativeDirectory.empty() && filter && !filter->Enters(relativeDirectory))
+		return;
+
+	const fs::path directory{ relativeDirectory.empty() ? root : root / fs::path(relativeDirectory) };
+
+	// Watch before listing, so a file created in between is seen by one or the other.
+	int wd{ ::inotify_add_watch(fd, directory.c_str(), watchMask) };
+	if (wd < 0) {
+		if (errno == ENOSPC) {
+			std::cerr << "[!] Out of inotify watches at " << directory << ", raise fs.inotify.max_user_watches\n";
+			overflowed = true;
+		}
+		return;
+	}
+
+	directories.insert_or_assign(wd, relativeDirectory);
+
+	std::error_code ec{};
+	for (fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec), end{}; !ec && it != end; it.increment(ec)) {
+		const std::string name{ it->path().filename().generic_string() };
+		const std::string relativePath{ relativeDirectory.empty() ? name : relativeDirectory + "/" + name };
+
+		std::error_code statError{};
+		if (it->is_symlink(statError))
+			continue;
+		if (it->is_directory(statError))
+			AddTree(relativePath, changed);
+		else if (it->is_regular_file(statError) && (!filter || filter->Admits(relativePath)))
+			changed.insert(relativePath);
+	}
+#endif
+}
+
+void DirectoryWatcher::RemoveTree(const std::string& relativeDirectory)
+{
+#ifdef __linux__
+	const std::string prefix{ relativeDirectory + "/" };
+
+	std::erase_if(directories, [&](const auto& directory) {
+		const bool inside{ directory.second == relativeDirectory || directory.second.starts_with(prefix) };
+		if (inside)
+			::inotify_rm_watch(fd, directory.first);
+
+		return inside;
+	});
+#endif
+}
+
+bool DirectoryWatcher::Poll(std::chrono::milliseconds timeout, std::set<std::string>& changed)
+{
+#ifdef __linux__
+	pollfd pending{ fd, POLLIN, 0 };
+	if (::poll(&pending, 1, static_cast<int>(timeout.count())) <= 0)
+		return !std::exchange(overflowed, false);
+
+	alignas(inotify_event) char buffer[64 * 1024];
+
+	for (;;) {
+		const ssize_t length{ ::read(fd, buffer, sizeof(buffer)) };
+		if (length <= 0)
+			break;
+
+		for (char* next = buffer; next < buffer + length;) {
+			const auto* event{ reinterpret_cast<const inotify_event*>(next) };
+			next += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				overflowed = true;
+				continue;
+			}
+
+			auto directory{ directories.find(event->wd) };
+			if (directory == directories.end())
+				continue;
+
+			if (event->mask & IN_IGNORED) {
+				directories.erase(directory);
+				continue;
+			}
+
+			if (event->len == 0)
+				continue;
+
+			const std::string name{ event->name };
+			const std::string relativePath{ directory->second.empty() ? name : directory->second + "/" + name };
+
+			if (event->mask & IN_ISDIR) {
+				// A directory created or moved in may already hold files by the time its watch is added.
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					AddTree(relativePath, changed);
+				else if (event->mask & IN_MOVED_FROM)
+					RemoveTree(relativePath);
+			}
+			else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB) && (!filter || filter->Admits(relativePath)))
+				changed.insert(relativePath);
+		}
+	}
+
+	return !std::exchange(overflowed, false);
+#else
+	std::this_thread::sleep_for(timeout);
+	return false;
+#endif
+}
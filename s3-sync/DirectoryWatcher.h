@@ -0,0 +1,39 @@
+#pragma once
+#include "Error.h"
+#include "PathFilter.h"
+
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+// Recursive inotify watch over a directory tree, reporting the files written, moved in or touched under it.
+class DirectoryWatcher {
+private:
+	std::filesystem::path root;
+	// Directories it won't enter aren't watched at all, which keeps excluded trees off the inotify limit.
+	const PathFilter* filter{ nullptr };
+	int fd{ -1 };
+	// Watch descriptor to the directory it covers, relative to root with '/' separators.
+	std::unordered_map<int, std::string> directories;
+	bool overflowed{ false };
+
+	DirectoryWatcher(std::filesystem::path root, const PathFilter* filter);
+	void AddTree(const std::string& relativeDirectory, std::set<std::string>& changed);
+	void RemoveTree(const std::string& relativeDirectory);
+
+public:
+	~DirectoryWatcher();
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+	// Fails where inotify isn't available, or the watch limit is too low for the tree.
+	static std::expected<std::unique_ptr<DirectoryWatcher>, Error::ErrorCode> Open(const std::filesystem::path& root, const PathFilter* filter = nullptr);
+
+	// Waits up to timeout and adds the relative path of every changed file to changed.
+	// Returns false if events were lost since the last call, in which case only a full scan is accurate.
+	bool Poll(std::chrono::milliseconds timeout, std::set<std::string>& changed);
+};
@@ -38,6 +38,24 @@ std::string_view Error::ErrorParser(Error::ErrorCode code) {
     case Error::ErrorCode::CorruptConfigFile:
         return "Corrupt configuration file.";
         break;
+    case Error::ErrorCode::CorruptManifest:
+        return "Corrupt or unwritable sync manifest.";
+        break;
+    case Error::ErrorCode::CorruptBundleIndex:
+        return "Corrupt bundle index in bucket.";
+        break;
+    case Error::ErrorCode::CompressionFailed:
+        return "Failed to compress or decompress an object.";
+        break;
+    case Error::ErrorCode::WatchFailed:
+        return "Failed to watch the directory for changes.";
+        break;
+    case Error::ErrorCode::CorruptChunkRecipe:
+        return "Corrupt chunk recipe in bucket.";
+        break;
+    case Error::ErrorCode::CopyFailed:
+        return "Failed to copy an object between buckets.";
+        break;
     default:
         return "Unknown error.";
         break;
@@ -14,7 +14,13 @@ namespace Error {
 		FileSystemError,
 		FailedToOpenFile,
 		NoConfigFile,
-        CorruptConfigFile
+        CorruptConfigFile,
+		CorruptManifest,
+		CorruptBundleIndex,
+		CompressionFailed,
+		WatchFailed,
+		CorruptChunkRecipe,
+		CopyFailed
 	};
 
 	std::string_view ErrorParser(Error::ErrorCode code);
@@ -0,0 +1,508 @@
+#include "IoEngine.h"
+
+#include <aws/core/utils/memory/AWSMemory.h>
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+
+#ifdef S3SYNC_HAVE_URING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <streambuf>
+#include <thread>
+#include <vector>
+#endif
+
+#ifdef S3SYNC_HAVE_URING
+namespace {
+	// Completion state shared by every operation one stream has in flight.
+	struct Tracker {
+		std::mutex mutex;
+		std::condition_variable done;
+		int inflight{ 0 };
+		bool failed{ false };
+	};
+
+	struct Operation {
+		Tracker* tracker{ nullptr };
+		int fd{ -1 };
+		int buffer{ -1 };
+		unsigned length{ 0 };
+		std::uint64_t offset{ 0 };
+		bool write{ false };
+		int result{ 0 };
+		bool complete{ false };
+	};
+}
+
+struct IoEngine::Ring {
+	io_uring ring{};
+	bool initialized{ false };
+	void* memory{ nullptr };
+	std::vector<iovec> buffers{};
+	std::mutex submitMutex{};
+	std::mutex poolMutex{};
+	std::condition_variable poolReady{};
+	std::vector<int> freeBuffers{};
+	std::thread reaper{};
+
+	~Ring()
+	{
+		if (reaper.joinable()) {
+			// An empty NOP tells the reaper to stop.
+			Operation* stop[]{ nullptr };
+			Submit(stop);
+			reaper.join();
+		}
+
+		if (initialized)
+			io_uring_queue_exit(&ring);
+		std::free(memory);
+	}
+
+	char* Data(int buffer)
+	{
+		return static_cast<char*>(buffers[buffer].iov_base);
+	}
+
+	// Readers only block for a buffer while they hold none, so streams can't starve each other into a deadlock.
+	int Acquire(bool wait)
+	{
+		std::unique_lock<std::mutex> lock(poolMutex);
+		if (wait)
+			poolReady.wait(lock, [&]() { return !freeBuffers.empty(); });
+
+		if (freeBuffers.empty())
+			return -1;
+
+		const int buffer{ freeBuffers.back() };
+		freeBuffers.pop_back();
+		return buffer;
+	}
+
+	void Release(int buffer)
+	{
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			freeBuffers.push_back(buffer);
+		}
+
+		poolReady.notify_one();
+	}
+
+	// Queues every operation and hands them to the kernel in a single submission.
+	void Submit(std::span<Operation* const> operations)
+	{
+		std::lock_guard<std::mutex> lock(submitMutex);
+
+		for (Operation* operation : operations) {
+			io_uring_sqe* sqe{ io_uring_get_sqe(&ring) };
+			while (!sqe) {
+				io_uring_submit(&ring);
+				sqe = io_uring_get_sqe(&ring);
+			}
+
+			if (!operation)
+				io_uring_prep_nop(sqe);
+			else if (operation->write)
+				io_uring_prep_write_fixed(sqe, operation->fd, Data(operation->buffer), operation->length, operation->offset, operation->buffer);
+			else
+				io_uring_prep_read_fixed(sqe, operation->fd, Data(operation->buffer), operation->length, operation->offset, operation->buffer);
+
+			io_uring_sqe_set_data(sqe, operation);
+		}
+
+		int submitted{ io_uring_submit(&ring) };
+		while (submitted == -EINTR || submitted == -EAGAIN || submitted == -EBUSY) {
+			std::this_thread::yield();
+			submitted = io_uring_submit(&ring);
+		}
+	}
+
+	void Reap()
+	{
+		for (;;) {
+			io_uring_cqe* cqe{ nullptr };
+			if (io_uring_wait_cqe(&ring, &cqe) < 0)
+				continue;
+
+			auto* operation{ static_cast<Operation*>(io_uring_cqe_get_data(cqe)) };
+			const int result{ cqe->res };
+			io_uring_cqe_seen(&ring, cqe);
+
+			if (!operation)
+				return;
+
+			Tracker* tracker{ operation->tracker };
+			const bool failed{ result != static_cast<int>(operation->length) };
+
+			// Writes give their buffer back as soon as they land; reads keep it until the stream has consumed it.
+			if (operation->write) {
+				Release(operation->buffer);
+				delete operation;
+				operation = nullptr;
+			}
+
+			// Notified under the lock, so a stream can't wake up, see nothing in flight and go away mid-notify.
+			std::lock_guard<std::mutex> lock(tracker->mutex);
+			if (operation) {
+				operation->result = result;
+				operation->complete = true;
+			}
+			tracker->failed |= failed;
+			--tracker->inflight;
+			tracker->done.notify_all();
+		}
+	}
+};
+
+namespace {
+	class RingReadBuf : public std::streambuf {
+	private:
+		// Reads queued ahead per stream; more only helps once the disk is slower than the network.
+		static constexpr std::size_t readAhead{ 4 };
+
+		IoEngine::Ring& ring;
+		int fd;
+		std::uint64_t start;
+		std::uint64_t length;
+		// Stream position of eback(), and of the next read to queue.
+		std::uint64_t areaStart{ 0 };
+		std::uint64_t nextRead{ 0 };
+		int current{ -1 };
+		// Latched on a failed read, so nothing after the gap is ever handed out; a seek starts over.
+		bool failed{ false };
+		std::deque<std::unique_ptr<Operation>> queued{};
+		Tracker tracker{};
+
+		void Fill()
+		{
+			std::vector<Operation*> batch{};
+
+			while (queued.size() < readAhead && nextRead < length) {
+				const int buffer{ ring.Acquire(queued.empty() && current < 0) };
+				if (buffer < 0)
+					break;
+
+				const auto readLength{ static_cast<unsigned>(std::min<std::uint64_t>(IoEngine::bufferSize, length - nextRead)) };
+				queued.push_back(std::make_unique<Operation>(Operation{ &tracker, fd, buffer, readLength, start + nextRead, false }));
+				batch.push_back(queued.back().get());
+				nextRead += readLength;
+			}
+
+			if (batch.empty())
+				return;
+
+			{
+				std::lock_guard<std::mutex> lock(tracker.mutex);
+				tracker.inflight += static_cast<int>(batch.size());
+			}
+
+			ring.Submit(batch);
+		}
+
+		void Drain()
+		{
+			{
+				std::unique_lock<std::mutex> lock(tracker.mutex);
+				tracker.done.wait(lock, [&]() { return tracker.inflight == 0; });
+			}
+
+			for (const auto& operation : queued)
+				ring.Release(operation->buffer);
+			queued.clear();
+
+			if (current >= 0) {
+				ring.Release(current);
+				current = -1;
+			}
+
+			setg(nullptr, nullptr, nullptr);
+		}
+
+		std::uint64_t Position() const
+		{
+			return areaStart + static_cast<std::uint64_t>(gptr() - eback());
+		}
+
+	public:
+		RingReadBuf(IoEngine::Ring& ring, int fd, std::uint64_t start, std::uint64_t length)
+			: ring{ ring }, fd{ fd }, start{ start }, length{ length }
+		{
+		}
+
+		~RingReadBuf() override
+		{
+			Drain();
+			::close(fd);
+		}
+
+	protected:
+		int_type underflow() override
+		{
+			if (gptr() < egptr())
+				return traits_type::to_int_type(*gptr());
+			if (failed)
+				return traits_type::eof();
+
+			areaStart += static_cast<std::uint64_t>(egptr() - eback());
+			if (current >= 0) {
+				ring.Release(current);
+				current = -1;
+			}
+			setg(nullptr, nullptr, nullptr);
+
+			Fill();
+			if (queued.empty())
+				return traits_type::eof();
+
+			std::unique_ptr<Operation> operation{ std::move(queued.front()) };
+			queued.pop_front();
+
+			{
+				std::unique_lock<std::mutex> lock(tracker.mutex);
+				tracker.done.wait(lock, [&]() { return operation->complete; });
+			}
+
+			current = operation->buffer;
+			// A short or failed read ends the body early, so the request fails on its content length.
+			if (operation->result != static_cast<int>(operation->length)) {
+				failed = true;
+				return traits_type::eof();
+			}
+
+			char* data{ ring.Data(current) };
+			setg(data, data, data + operation->length);
+
+			Fill();
+			return traits_type::to_int_type(*gptr());
+		}
+
+		pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+		{
+			if (!(which & std::ios_base::in))
+				return pos_type(off_type(-1));
+
+			off_type base{ 0 };
+			if (direction == std::ios_base::cur)
+				base = static_cast<off_type>(Position());
+			else if (direction == std::ios_base::end)
+				base = static_cast<off_type>(length);
+
+			return seekpos(pos_type(base + offset), which);
+		}
+
+		pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+		{
+			const off_type target{ position };
+			if (!(which & std::ios_base::in) || target < 0 || static_cast<std::uint64_t>(target) > length)
+				return pos_type(off_type(-1));
+
+			const std::uint64_t absolute{ static_cast<std::uint64_t>(target) };
+			if (absolute == Position())
+				return position;
+
+			// Within the buffer being read it's only a pointer move.
+			if (eback() && absolute >= areaStart && absolute <= areaStart + static_cast<std::uint64_t>(egptr() - eback())) {
+				setg(eback(), eback() + (absolute - areaStart), egptr());
+				return position;
+			}
+
+			// Anywhere else (usually a rewind for a retry) the read-ahead is dropped and started over.
+			Drain();
+			areaStart = nextRead = absolute;
+			failed = false;
+			return position;
+		}
+
+		std::streamsize showmanyc() override
+		{
+			const std::uint64_t remaining{ length - Position() };
+			return remaining > 0 ? static_cast<std::streamsize>(remaining) : -1;
+		}
+	};
+
+	class RingWriteBuf : public std::streambuf {
+	private:
+		IoEngine::Ring& ring;
+		int fd;
+		// File offset the current buffer will be written at.
+		std::uint64_t position;
+		int current{ -1 };
+		Tracker tracker{};
+
+		void Queue()
+		{
+			if (current < 0)
+				return;
+
+			const auto writeLength{ static_cast<unsigned>(pptr() - pbase()) };
+			if (writeLength == 0)
+				ring.Release(current);
+			else {
+				Operation* operations[]{ new Operation{ &tracker, fd, current, writeLength, position, true } };
+				position += writeLength;
+
+				{
+					std::lock_guard<std::mutex> lock(tracker.mutex);
+					++tracker.inflight;
+				}
+
+				ring.Submit(operations);
+			}
+
+			current = -1;
+			setp(nullptr, nullptr);
+		}
+
+	public:
+		RingWriteBuf(IoEngine::Ring& ring, int fd, std::uint64_t position)
+			: ring{ ring }, fd{ fd }, position{ position }
+		{
+		}
+
+		~RingWriteBuf() override
+		{
+			sync();
+			if (fd >= 0)
+				::close(fd);
+		}
+
+	protected:
+		int_type overflow(int_type c) override
+		{
+			if (fd < 0)
+				return traits_type::eof();
+
+			// Written behind the caller: the full buffer goes to the kernel and the next one is filled meanwhile.
+			Queue();
+			if (traits_type::eq_int_type(c, traits_type::eof()))
+				return traits_type::not_eof(c);
+
+			current = ring.Acquire(true);
+			char* data{ ring.Data(current) };
+			setp(data, data + IoEngine::bufferSize);
+
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+			return c;
+		}
+
+		int sync() override
+		{
+			Queue();
+
+			std::unique_lock<std::mutex> lock(tracker.mutex);
+			tracker.done.wait(lock, [&]() { return tracker.inflight == 0; });
+			return fd < 0 || tracker.failed ? -1 : 0;
+		}
+	};
+
+	class RingReadStream : public Aws::IOStream {
+	private:
+		RingReadBuf buffer;
+
+	public:
+		RingReadStream(IoEngine::Ring& ring, int fd, std::uint64_t start, std::uint64_t length)
+			: Aws::IOStream(nullptr), buffer{ ring, fd, start, length }
+		{
+			rdbuf(&buffer);
+		}
+	};
+
+	class RingWriteStream : public Aws::IOStream {
+	private:
+		RingWriteBuf buffer;
+
+	public:
+		RingWriteStream(IoEngine::Ring& ring, int fd, std::uint64_t position)
+			: Aws::IOStream(nullptr), buffer{ ring, fd, position }
+		{
+			rdbuf(&buffer);
+			if (fd < 0)
+				setstate(std::ios_base::badbit);
+		}
+	};
+}
+#else
+struct IoEngine::Ring {
+};
+#endif
+
+IoEngine::IoEngine(std::unique_ptr<Ring> ring)
+	: ring{ std::move(ring) }
+{
+}
+
+IoEngine::~IoEngine() = default;
+
+std::unique_ptr<IoEngine> IoEngine::Create(std::size_t bufferCount)
+{
+#ifdef S3SYNC_HAVE_URING
+	auto ring{ std::make_unique<Ring>() };
+
+	// Every operation holds a buffer, so a ring this deep never runs out of submission slots.
+	if (io_uring_queue_init(static_cast<unsigned>(bufferCount), &ring->ring, 0) < 0)
+		return nullptr;
+	ring->initialized = true;
+
+	ring->memory = std::aligned_alloc(4096, bufferCount * bufferSize);
+	if (!ring->memory)
+		return nullptr;
+
+	ring->buffers.resize(bufferCount);
+	ring->freeBuffers.reserve(bufferCount);
+	for (std::size_t i = 0; i < bufferCount; ++i) {
+		ring->buffers[i] = iovec{ static_cast<char*>(ring->memory) + i * bufferSize, bufferSize };
+		ring->freeBuffers.push_back(static_cast<int>(i));
+	}
+
+	// Registered once, so the kernel doesn't map and pin the pages again for every read and write.
+	if (io_uring_register_buffers(&ring->ring, ring->buffers.data(), static_cast<unsigned>(ring->buffers.size())) < 0)
+		return nullptr;
+
+	ring->reaper = std::thread([raw = ring.get()]() { raw->Reap(); });
+
+	return std::unique_ptr<IoEngine>(new IoEngine(std::move(ring)));
+#else
+	(void)bufferCount;
+	return nullptr;
+#endif
+}
+
+std::expected<std::shared_ptr<Aws::IOStream>, Error::ErrorCode> IoEngine::OpenReader(const std::filesystem::path& path, std::uint64_t offset, std::uint64_t length)
+{
+#ifdef S3SYNC_HAVE_URING
+	const int fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+	if (fd < 0)
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+
+	::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_SEQUENTIAL);
+	return Aws::MakeShared<RingReadStream>("s3-sync", *ring, fd, offset, length);
+#else
+	(void)path;
+	(void)offset;
+	(void)length;
+	return std::unexpected(Error::ErrorCode::OpenFileFailed);
+#endif
+}
+
+Aws::IOStream* IoEngine::OpenWriter(const std::filesystem::path& path, std::uint64_t offset, bool truncate)
+{
+#ifdef S3SYNC_HAVE_URING
+	const int fd{ ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644) };
+	return Aws::New<RingWriteStream>("s3-sync", *ring, fd, offset);
+#else
+	(void)path;
+	(void)offset;
+	(void)truncate;
+	return nullptr;
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Error.h"
+
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Asynchronous file reads and writes on io_uring, staged through a bounded pool of registered buffers.
+// Request bodies read ahead of the SDK and response bodies are written behind it, so transfer
+// threads spend their time on the network instead of blocking on the disk.
+class IoEngine {
+public:
+	struct Ring;
+
+private:
+	std::unique_ptr<Ring> ring;
+
+	explicit IoEngine(std::unique_ptr<Ring> ring);
+
+public:
+	static constexpr std::size_t bufferSize{ 256 * 1024 };
+
+	~IoEngine();
+
+	IoEngine(const IoEngine&) = delete;
+	IoEngine& operator=(const IoEngine&) = delete;
+
+	// Null when the build has no liburing or the kernel won't set up a ring (too old, or blocked by seccomp).
+	static std::unique_ptr<IoEngine> Create(std::size_t bufferCount);
+
+	// Request body over [offset, offset + length) of path, seekable so the SDK can rewind it for a retry.
+	std::expected<std::shared_ptr<Aws::IOStream>, Error::ErrorCode> OpenReader(const std::filesystem::path& path, std::uint64_t offset, std::uint64_t length);
+	// Response body writing into path from offset on, allocated with Aws::New for a response stream factory.
+	// flush() returns once every write has reached the file, and fails if any of them didn't.
+	Aws::IOStream* OpenWriter(const std::filesystem::path& path, std::uint64_t offset, bool truncate);
+};
@@ -0,0 +1,193 @@
+#include "Manifest.h"
+#include "Serialization.h"
+
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <charconv>
+
+namespace {
+	constexpr std::array<char, 4> magic{ 'S', '3', 'S', 'M' };
+	constexpr std::uint32_t version{ 1 };
+
+	using Serialization::WriteValue;
+	using Serialization::ReadValue;
+	using Serialization::WriteString;
+	using Serialization::ReadString;
+	using Serialization::HashName;
+}
+
+Manifest::Manifest(std::filesystem::path path)
+	: path{ std::move(path) }
+{
+}
+
+std::filesystem::path Manifest::PathFor(const std::filesystem::path& stateDirectory, const std::filesystem::path& localPath, std::string_view bucket)
+{
+	std::error_code ec{};
+	auto absolutePath{ std::filesystem::weakly_canonical(localPath, ec) };
+	if (ec)
+		absolutePath = std::filesystem::absolute(localPath);
+
+	std::string identity{ absolutePath.generic_string() };
+	identity += '\n';
+	identity += bucket;
+
+	std::array<char, 16> name{};
+	auto [end, error] { std::to_chars(name.data(), name.data() + name.size(), HashName(identity), 16) };
+
+	return stateDirectory / "manifests" / (std::string(name.data(), end) + ".manifest");
+}
+
+std::expected<void, Error::ErrorCode> Manifest::Load()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	entries.clear();
+	generation = 0;
+
+	if (!std::filesystem::exists(path))
+		return{};
+
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open())
+		return std::unexpected(Error::ErrorCode::CorruptManifest);
+
+	std::array<char, 4> fileMagic{};
+	std::uint32_t fileVersion{ 0 };
+	std::uint64_t count{ 0 };
+
+	in.read(fileMagic.data(), fileMagic.size());
+	if (!in || fileMagic != magic || !ReadValue(in, fileVersion) || fileVersion != version
+		|| !ReadValue(in, generation) || !ReadValue(in, count))
+	{
+		generation = 0;
+		return std::unexpected(Error::ErrorCode::CorruptManifest);
+	}
+
+	// Every entry takes at least its fixed-size fields, so a count the file can't hold is corrupt rather than reserved.
+	constexpr std::uint64_t minEntrySize{ 2 * sizeof(std::uint32_t) + sizeof(ManifestEntry::size) + sizeof(ManifestEntry::modifiedTime) + sizeof(ManifestEntry::generation) };
+	std::error_code ec{};
+	const std::uint64_t fileSize{ std::filesystem::file_size(path, ec) };
+	if (ec || count > fileSize / minEntrySize) {
+		generation = 0;
+		return std::unexpected(Error::ErrorCode::CorruptManifest);
+	}
+
+	entries.reserve(count);
+
+	for (std::uint64_t i = 0; i < count; ++i) {
+		std::string key{};
+		ManifestEntry entry{};
+
+		if (!ReadString(in, key) || !ReadValue(in, entry.size) || !ReadValue(in, entry.modifiedTime)
+			|| !ReadString(in, entry.eTag) || !ReadValue(in, entry.generation))
+		{
+			entries.clear();
+			generation = 0;
+			return std::unexpected(Error::ErrorCode::CorruptManifest);
+		}
+
+		entries.emplace(std::move(key), std::move(entry));
+	}
+
+	// Every load starts a new generation; entries touched during this run are stamped with it.
+	++generation;
+
+	return{};
+}
+
+std::expected<void, Error::ErrorCode> Manifest::Save()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::error_code ec{};
+	std::filesystem::create_directories(path.parent_path(), ec);
+	if (ec)
+		return std::unexpected(Error::ErrorCode::CorruptManifest);
+
+	// Write next to the real file and rename, so a crash never leaves a half-written manifest.
+	auto tempPath{ path };
+	tempPath += ".tmp";
+
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return std::unexpected(Error::ErrorCode::CorruptManifest);
+
+		out.write(magic.data(), magic.size());
+		WriteValue(out, version);
+		WriteValue(out, generation);
+		WriteValue(out, static_cast<std::uint64_t>(entries.size()));
+
+		for (const auto& [key, entry] : entries) {
+			WriteString(out, key);
+			WriteValue(out, entry.size);
+			WriteValue(out, entry.modifiedTime);
+			WriteString(out, entry.eTag);
+			WriteValue(out, entry.generation);
+		}
+
+		if (!out.flush())
+			return std::unexpected(Error::ErrorCode::CorruptManifest);
+	}
+
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+		return std::unexpected(Error::ErrorCode::CorruptManifest);
+
+	return{};
+}
+
+std::optional<ManifestEntry> Manifest::Find(const std::string& key) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it{ entries.find(key) };
+	if (it == entries.end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+void Manifest::Update(const std::string& key, ManifestEntry entry)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	entry.generation = generation;
+	entries.insert_or_assign(key, std::move(entry));
+}
+
+void Manifest::Touch(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it{ entries.find(key) };
+	if (it != entries.end())
+		it->second.generation = generation;
+}
+
+void Manifest::Erase(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.erase(key);
+}
+
+void Manifest::Prune()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::erase_if(entries, [this](const auto& item) { return item.second.generation != generation; });
+}
+
+bool Manifest::Empty() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.empty();
+}
+
+std::uint64_t Manifest::Generation() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return generation;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "Error.h"
+
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <filesystem>
+#include <mutex>
+#include <cstdint>
+
+// Size, mtime and ETag of a file as of the last time it was in sync with its object.
+struct ManifestEntry {
+	std::uint64_t size{ 0 };
+	std::int64_t modifiedTime{ 0 };
+	std::string eTag{};
+	std::uint64_t generation{ 0 };
+};
+
+// On-disk record of a (directory, bucket) pair, so later runs only touch what changed.
+class Manifest {
+private:
+	std::filesystem::path path;
+	std::unordered_map<std::string, ManifestEntry> entries;
+	std::uint64_t generation{ 0 };
+	mutable std::mutex mutex;
+
+public:
+	explicit Manifest(std::filesystem::path path);
+
+	static std::filesystem::path PathFor(const std::filesystem::path& stateDirectory, const std::filesystem::path& localPath, std::string_view bucket);
+
+	std::expected<void, Error::ErrorCode> Load();
+	std::expected<void, Error::ErrorCode> Save();
+
+	std::optional<ManifestEntry> Find(const std::string& key) const;
+	void Update(const std::string& key, ManifestEntry entry);
+	void Touch(const std::string& key);
+	void Erase(const std::string& key);
+	void Prune();
+
+	bool Empty() const;
+	std::uint64_t Generation() const;
+};
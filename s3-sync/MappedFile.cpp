@@ -0,0 +1,138 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (mapping)
+		UnmapViewOfFile(mapping);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle && fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+#else
+	if (mapping)
+		::munmap(mapping, mappingLength);
+#endif
+}
+
+std::expected<std::shared_ptr<MappedFile>, Error::ErrorCode> MappedFile::Open(const std::filesystem::path& path, std::uint64_t offset, std::uint64_t length)
+{
+	std::shared_ptr<MappedFile> file{ new MappedFile() };
+	file->length = static_cast<std::size_t>(length);
+
+	// Nothing to map; an empty view still makes a valid (empty) body.
+	if (length == 0)
+		return file;
+
+#ifdef _WIN32
+	SYSTEM_INFO systemInfo{};
+	GetSystemInfo(&systemInfo);
+	const std::uint64_t alignedOffset{ offset - offset % systemInfo.dwAllocationGranularity };
+
+	file->fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file->fileHandle == INVALID_HANDLE_VALUE)
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+
+	file->mappingHandle = CreateFileMappingW(file->fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!file->mappingHandle)
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+
+	file->mappingLength = static_cast<std::size_t>(length + (offset - alignedOffset));
+	file->mapping = MapViewOfFile(file->mappingHandle, FILE_MAP_READ,
+		static_cast<DWORD>(alignedOffset >> 32), static_cast<DWORD>(alignedOffset & 0xFFFFFFFF), file->mappingLength);
+	if (!file->mapping)
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+#else
+	const std::uint64_t pageSize{ static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE)) };
+	const std::uint64_t alignedOffset{ offset - offset % pageSize };
+
+	int fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+	if (fd < 0)
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+
+	// Touching pages past the end of the file raises SIGBUS, so refuse ranges the file no longer covers.
+	struct stat info {};
+	if (::fstat(fd, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < offset + length) {
+		::close(fd);
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+	}
+
+	file->mappingLength = static_cast<std::size_t>(length + (offset - alignedOffset));
+	void* mapping{ ::mmap(nullptr, file->mappingLength, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(alignedOffset)) };
+	// The mapping keeps its own reference to the file.
+	::close(fd);
+
+	if (mapping == MAP_FAILED)
+		return std::unexpected(Error::ErrorCode::OpenFileFailed);
+
+	file->mapping = mapping;
+	// Bodies are read front to back once; let the kernel read ahead aggressively and drop pages early.
+	::madvise(file->mapping, file->mappingLength, MADV_SEQUENTIAL);
+#endif
+
+	file->data = static_cast<const char*>(file->mapping) + (offset - alignedOffset);
+	return file;
+}
+
+const char* MappedFile::Data() const
+{
+	return data;
+}
+
+std::size_t MappedFile::Size() const
+{
+	return length;
+}
+
+MappedStreamBuf::MappedStreamBuf(std::shared_ptr<MappedFile> file)
+	: file{ std::move(file) }
+{
+	// The get area is never written through, so dropping const is safe.
+	char* begin{ const_cast<char*>(this->file->Data()) };
+	setg(begin, begin, begin + this->file->Size());
+}
+
+MappedStreamBuf::pos_type MappedStreamBuf::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which)
+{
+	if (!(which & std::ios_base::in))
+		return pos_type(off_type(-1));
+
+	off_type base{ 0 };
+	if (direction == std::ios_base::cur)
+		base = gptr() - eback();
+	else if (direction == std::ios_base::end)
+		base = egptr() - eback();
+
+	return seekpos(pos_type(base + offset), which);
+}
+
+MappedStreamBuf::pos_type MappedStreamBuf::seekpos(pos_type position, std::ios_base::openmode which)
+{
+	const off_type target{ position };
+	if (!(which & std::ios_base::in) || target < 0 || target > egptr() - eback())
+		return pos_type(off_type(-1));
+
+	setg(eback(), eback() + target, egptr());
+	return position;
+}
+
+std::streamsize MappedStreamBuf::showmanyc()
+{
+	const auto remaining{ egptr() - gptr() };
+	return remaining > 0 ? remaining : -1;
+}
+
+MappedStream::MappedStream(std::shared_ptr<MappedFile> file)
+	: Aws::IOStream(nullptr), buffer{ std::move(file) }
+{
+	rdbuf(&buffer);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "Error.h"
+
+#include <aws/core/utils/memory/stl/AWSStreamFwd.h>
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <streambuf>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a byte range of a file.
+class MappedFile {
+private:
+	void* mapping{ nullptr };
+	std::size_t mappingLength{ 0 };
+	const char* data{ nullptr };
+	std::size_t length{ 0 };
+#ifdef _WIN32
+	void* fileHandle{ nullptr };
+	void* mappingHandle{ nullptr };
+#endif
+
+	MappedFile() = default;
+
+public:
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	static std::expected<std::shared_ptr<MappedFile>, Error::ErrorCode> Open(const std::filesystem::path& path, std::uint64_t offset, std::uint64_t length);
+
+	const char* Data() const;
+	std::size_t Size() const;
+};
+
+// Streambuf reading straight out of a mapping, so the SDK reads file pages without any copy.
+class MappedStreamBuf : public std::streambuf {
+private:
+	std::shared_ptr<MappedFile> file;
+
+public:
+	explicit MappedStreamBuf(std::shared_ptr<MappedFile> file);
+
+protected:
+	pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+	std::streamsize showmanyc() override;
+};
+
+// Request body for PutObject and UploadPart backed by a mapping.
+class MappedStream : public Aws::IOStream {
+private:
+	MappedStreamBuf buffer;
+
+public:
+	explicit MappedStream(std::shared_ptr<MappedFile> file);
+};
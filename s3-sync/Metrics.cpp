@@ -0,0 +1,277 @@
+#include "Metrics.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+	constexpr std::array<std::string_view, 3> outcomeNames{ "transferred", "skipped", "failed" };
+	constexpr std::array<std::string_view, 6> requestNames{ "list", "put", "get", "delete", "copy", "multipart" };
+
+	std::string FormatBytes(double bytes)
+	{
+		constexpr std::array<std::string_view, 5> units{ "B", "KiB", "MiB", "GiB", "TiB" };
+
+		std::size_t unit{ 0 };
+		while (bytes >= 1024.0 && unit + 1 < units.size()) {
+			bytes /= 1024.0;
+			++unit;
+		}
+
+		std::ostringstream out{};
+		out << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << bytes << " " << units[unit];
+		return out.str();
+	}
+
+	bool StderrIsTerminal()
+	{
+#ifdef _WIN32
+		return _isatty(_fileno(stderr)) != 0;
+#else
+		return ::isatty(STDERR_FILENO) != 0;
+#endif
+	}
+}
+
+void Metrics::Record(Outcome outcome, std::uint64_t bytes, std::uint64_t objects)
+{
+	Counter& counter{ outcomes[static_cast<std::size_t>(outcome)] };
+	counter.objects.fetch_add(objects, std::memory_order_relaxed);
+	counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Metrics::Notice(std::string message)
+{
+	std::lock_guard<std::mutex> lock(noticeMutex);
+
+	if (progressShown)
+		pendingNotices.push_back(std::move(message));
+	else
+		std::cerr << "[!] " << message << "\n";
+}
+
+void Metrics::RecordRequest(Request request, std::chrono::steady_clock::duration latency)
+{
+	Histogram& histogram{ requests[static_cast<std::size_t>(request)] };
+	const double seconds{ std::chrono::duration<double>(latency).count() };
+
+	std::size_t bucket{ 0 };
+	while (bucket < bucketBounds.size() && seconds > bucketBounds[bucket])
+		++bucket;
+
+	histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	histogram.count.fetch_add(1, std::memory_order_relaxed);
+	histogram.sumMicroseconds.fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count()), std::memory_order_relaxed);
+}
+
+void Metrics::RecordRetry()
+{
+	retries.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t Metrics::Objects(Outcome outcome) const
+{
+	return outcomes[static_cast<std::size_t>(outcome)].objects.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Metrics::Bytes(Outcome outcome) const
+{
+	return outcomes[static_cast<std::size_t>(outcome)].bytes.load(std::memory_order_relaxed);
+}
+
+double Metrics::ElapsedSeconds() const
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string Metrics::Summary() const
+{
+	const double seconds{ ElapsedSeconds() };
+	const double transferredBytes{ static_cast<double>(Bytes(Outcome::Transferred)) };
+
+	std::ostringstream out{};
+	out << Objects(Outcome::Transferred) << " transferred (" << FormatBytes(transferredBytes) << "), "
+		<< Objects(Outcome::Skipped) << " skipped, "
+		<< Objects(Outcome::Failed) << " failed in "
+		<< std::fixed << std::setprecision(1) << seconds << " s, "
+		<< FormatBytes(seconds > 0.0 ? transferredBytes / seconds : 0.0) << "/s";
+
+	return out.str();
+}
+
+std::string Metrics::JsonReport(std::string_view operation) const
+{
+	const double seconds{ ElapsedSeconds() };
+
+	std::ostringstream out{};
+	out << std::setprecision(6);
+	out << "{\n  \"operation\": \"" << operation << "\",\n"
+		<< "  \"durationSeconds\": " << seconds << ",\n"
+		<< "  \"throughputBytesPerSecond\": " << (seconds > 0.0 ? static_cast<double>(Bytes(Outcome::Transferred)) / seconds : 0.0) << ",\n"
+		<< "  \"retries\": " << retries.load(std::memory_order_relaxed) << ",\n";
+
+	out << "  \"objects\": {";
+	for (std::size_t i = 0; i < outcomes.size(); ++i)
+		out << (i ? ", " : " ") << "\"" << outcomeNames[i] << "\": " << outcomes[i].objects.load(std::memory_order_relaxed);
+	out << " },\n  \"bytes\": {";
+	for (std::size_t i = 0; i < outcomes.size(); ++i)
+		out << (i ? ", " : " ") << "\"" << outcomeNames[i] << "\": " << outcomes[i].bytes.load(std::memory_order_relaxed);
+	out << " },\n  \"requests\": {\n";
+
+	for (std::size_t i = 0; i < requests.size(); ++i) {
+		const Histogram& histogram{ requests[i] };
+
+		out << "    \"" << requestNames[i] << "\": { \"count\": " << histogram.count.load(std::memory_order_relaxed)
+			<< ", \"sumSeconds\": " << static_cast<double>(histogram.sumMicroseconds.load(std::memory_order_relaxed)) / 1e6
+			<< ", \"buckets\": [";
+
+		for (std::size_t bucket = 0; bucket < histogram.buckets.size(); ++bucket) {
+			out << (bucket ? ", " : " ") << "{ \"le\": ";
+			if (bucket < bucketBounds.size())
+				out << bucketBounds[bucket];
+			else
+				out << "\"+Inf\"";
+			out << ", \"count\": " << histogram.buckets[bucket].load(std::memory_order_relaxed) << " }";
+		}
+
+		out << " ] }" << (i + 1 < requests.size() ? "," : "") << "\n";
+	}
+
+	out << "  }\n}\n";
+	return out.str();
+}
+
+std::string Metrics::PrometheusReport(std::string_view operation) const
+{
+	const double seconds{ ElapsedSeconds() };
+
+	std::ostringstream out{};
+	out << std::setprecision(6);
+
+	out << "# HELP s3sync_objects_total Objects handled by the last run, by outcome.\n"
+		<< "# TYPE s3sync_objects_total counter\n";
+	for (std::size_t i = 0; i < outcomes.size(); ++i)
+		out << "s3sync_objects_total{operation=\"" << operation << "\",outcome=\"" << outcomeNames[i] << "\"} " << outcomes[i].objects.load(std::memory_order_relaxed) << "\n";
+
+	out << "# HELP s3sync_bytes_total Bytes handled by the last run, by outcome.\n"
+		<< "# TYPE s3sync_bytes_total counter\n";
+	for (std::size_t i = 0; i < outcomes.size(); ++i)
+		out << "s3sync_bytes_total{operation=\"" << operation << "\",outcome=\"" << outcomeNames[i] << "\"} " << outcomes[i].bytes.load(std::memory_order_relaxed) << "\n";
+
+	out << "# HELP s3sync_request_retries_total Requests retried after throttling or transient errors.\n"
+		<< "# TYPE s3sync_request_retries_total counter\n"
+		<< "s3sync_request_retries_total{operation=\"" << operation << "\"} " << retries.load(std::memory_order_relaxed) << "\n";
+
+	out << "# HELP s3sync_duration_seconds Wall time of the last run.\n"
+		<< "# TYPE s3sync_duration_seconds gauge\n"
+		<< "s3sync_duration_seconds{operation=\"" << operation << "\"} " << seconds << "\n";
+
+	out << "# HELP s3sync_throughput_bytes_per_second Transferred bytes over the wall time of the last run.\n"
+		<< "# TYPE s3sync_throughput_bytes_per_second gauge\n"
+		<< "s3sync_throughput_bytes_per_second{operation=\"" << operation << "\"} "
+		<< (seconds > 0.0 ? static_cast<double>(Bytes(Outcome::Transferred)) / seconds : 0.0) << "\n";
+
+	out << "# HELP s3sync_request_duration_seconds Latency of S3 requests, by request type.\n"
+		<< "# TYPE s3sync_request_duration_seconds histogram\n";
+	for (std::size_t i = 0; i < requests.size(); ++i) {
+		const Histogram& histogram{ requests[i] };
+		const std::string labels{ "operation=\"" + std::string{ operation } + "\",request=\"" + std::string{ requestNames[i] } + "\"" };
+
+		// Prometheus buckets are cumulative.
+		std::uint64_t cumulative{ 0 };
+		for (std::size_t bucket = 0; bucket < histogram.buckets.size(); ++bucket) {
+			cumulative += histogram.buckets[bucket].load(std::memory_order_relaxed);
+
+			out << "s3sync_request_duration_seconds_bucket{" << labels << ",le=\"";
+			if (bucket < bucketBounds.size())
+				out << bucketBounds[bucket];
+			else
+				out << "+Inf";
+			out << "\"} " << cumulative << "\n";
+		}
+
+		out << "s3sync_request_duration_seconds_sum{" << labels << "} " << static_cast<double>(histogram.sumMicroseconds.load(std::memory_order_relaxed)) / 1e6 << "\n"
+			<< "s3sync_request_duration_seconds_count{" << labels << "} " << cumulative << "\n";
+	}
+
+	return out.str();
+}
+
+std::expected<void, Error::ErrorCode> Metrics::WriteReport(const std::filesystem::path& path, ReportFormat format, std::string_view operation) const
+{
+	const std::string report{ format == ReportFormat::Json ? JsonReport(operation) : PrometheusReport(operation) };
+
+	// Written aside and renamed, so a collector scraping the file never sees half a report.
+	std::filesystem::path temporaryPath{ path };
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(report.data(), static_cast<std::streamsize>(report.size())))
+			return std::unexpected(Error::ErrorCode::FileSystemError);
+	}
+
+	std::error_code ec{};
+	std::filesystem::rename(temporaryPath, path, ec);
+	if (ec)
+		return std::unexpected(Error::ErrorCode::FileSystemError);
+
+	return{};
+}
+
+ProgressLine::ProgressLine(const Metrics& metrics)
+	: metrics{ metrics }
+{
+	// Redirected output gets the final summary only, not a stream of carriage returns.
+	if (!StderrIsTerminal())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(this->metrics.noticeMutex);
+		this->metrics.progressShown = true;
+	}
+
+	printer = std::jthread([this](std::stop_token stopToken) {
+		while (!stopToken.stop_requested()) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait_for(lock, stopToken, std::chrono::seconds(1), []() { return false; });
+			}
+
+			Redraw(this->metrics.Summary());
+		}
+	});
+}
+
+ProgressLine::~ProgressLine()
+{
+	if (!printer.joinable())
+		return;
+
+	printer.request_stop();
+	printer.join();
+	Redraw({});
+
+	std::lock_guard<std::mutex> lock(metrics.noticeMutex);
+	metrics.progressShown = false;
+}
+
+void ProgressLine::Redraw(std::string_view line)
+{
+	std::lock_guard<std::mutex> lock(metrics.noticeMutex);
+
+	// Notices go above the line, each on its own, and the line is drawn again below them.
+	std::cerr << "\r\033[K";
+	for (const auto& notice : metrics.pendingNotices)
+		std::cerr << "[!] " << notice << "\n";
+	metrics.pendingNotices.clear();
+
+	std::cerr << line << std::flush;
+}
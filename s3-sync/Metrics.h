@@ -0,0 +1,103 @@
+#pragma once
+#include "Error.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+enum class ReportFormat {
+	Json,
+	Prometheus
+};
+
+// Counters for one run. Everything is a relaxed atomic, so recording never blocks a transfer;
+// readers only ever need a roughly consistent snapshot.
+class Metrics {
+public:
+	enum class Outcome {
+		Transferred,
+		Skipped,
+		Failed
+	};
+
+	enum class Request {
+		List,
+		Put,
+		Get,
+		Delete,
+		// Server-side CopyObject and UploadPartCopy, which move no bytes through the client.
+		Copy,
+		// Creating, completing, aborting and listing the parts of multipart uploads.
+		Multipart
+	};
+
+	// Upper bounds of the latency buckets in seconds, the last one being +Inf.
+	static constexpr std::array<double, 13> bucketBounds{ 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0 };
+
+private:
+	struct Counter {
+		std::atomic<std::uint64_t> objects{ 0 };
+		std::atomic<std::uint64_t> bytes{ 0 };
+	};
+
+	struct Histogram {
+		std::array<std::atomic<std::uint64_t>, bucketBounds.size() + 1> buckets{};
+		std::atomic<std::uint64_t> count{ 0 };
+		std::atomic<std::uint64_t> sumMicroseconds{ 0 };
+	};
+
+	std::array<Counter, 3> outcomes{};
+	std::array<Histogram, 6> requests{};
+	std::atomic<std::uint64_t> retries{ 0 };
+	const std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+
+	// Notices held while a progress line is shown, which prints them between its redraws. Output plumbing
+	// rather than counters, so the progress line can drain them through the const reference it holds.
+	friend class ProgressLine;
+	mutable std::mutex noticeMutex;
+	mutable std::vector<std::string> pendingNotices;
+	mutable bool progressShown{ false };
+
+	double ElapsedSeconds() const;
+	std::string JsonReport(std::string_view operation) const;
+	std::string PrometheusReport(std::string_view operation) const;
+
+public:
+	void Record(Outcome outcome, std::uint64_t bytes, std::uint64_t objects = 1);
+	void RecordRequest(Request request, std::chrono::steady_clock::duration latency);
+	void RecordRetry();
+	// A "[!]" line on stderr for things that happen in the background, kept out of the middle of the progress line.
+	void Notice(std::string message);
+
+	std::uint64_t Objects(Outcome outcome) const;
+	std::uint64_t Bytes(Outcome outcome) const;
+
+	// One line, used both for the live progress line and the closing summary.
+	std::string Summary() const;
+	std::expected<void, Error::ErrorCode> WriteReport(const std::filesystem::path& path, ReportFormat format, std::string_view operation) const;
+};
+
+// Redraws the summary on one terminal line every second while it's alive.
+class ProgressLine {
+private:
+	const Metrics& metrics;
+	std::mutex mutex;
+	std::condition_variable_any wake;
+	std::jthread printer;
+
+	// Clears the line, prints any pending notices, then draws line in its place.
+	void Redraw(std::string_view line);
+
+public:
+	explicit ProgressLine(const Metrics& metrics);
+	~ProgressLine();
+};
@@ -0,0 +1,282 @@
+#include "PathFilter.h"
+
+#include <algorithm>
+
+namespace {
+	std::vector<std::string_view> Split(std::string_view path)
+	{
+		std::vector<std::string_view> segments{};
+
+		while (!path.empty()) {
+			auto separator{ path.find('/') };
+			if (separator != 0)
+				segments.push_back(path.substr(0, separator));
+			if (separator == std::string_view::npos)
+				break;
+			path.remove_prefix(separator + 1);
+		}
+
+		return segments;
+	}
+
+	// Characters of pattern used to match c, or 0 when it doesn't match.
+	std::size_t MatchOne(std::string_view pattern, char c)
+	{
+		if (pattern[0] == '?')
+			return 1;
+
+		if (pattern[0] == '\\' && pattern.size() > 1)
+			return pattern[1] == c ? 2 : 0;
+
+		if (pattern[0] != '[')
+			return pattern[0] == c ? 1 : 0;
+
+		std::size_t i{ 1 };
+		const bool negated{ i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^') };
+		if (negated)
+			++i;
+
+		bool matched{ false };
+		// A ']' right after the opening bracket is part of the set.
+		for (std::size_t first = i; i < pattern.size() && (i == first || pattern[i] != ']'); ++i) {
+			if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+				matched = matched || (pattern[i] <= c && c <= pattern[i + 2]);
+				i += 2;
+			}
+			else
+				matched = matched || pattern[i] == c;
+		}
+
+		// An unclosed bracket is just a '['.
+		if (i == pattern.size())
+			return c == '[' ? 1 : 0;
+
+		return matched != negated ? i + 1 : 0;
+	}
+
+	// '*' and '?' never match a '/', which segments don't contain anyway.
+	bool MatchSegment(std::string_view pattern, std::string_view text)
+	{
+		std::size_t p{ 0 };
+		std::size_t t{ 0 };
+		std::size_t starPattern{ std::string_view::npos };
+		std::size_t starText{ 0 };
+
+		while (t < text.size()) {
+			if (p < pattern.size() && pattern[p] == '*') {
+				starPattern = ++p;
+				starText = t;
+				continue;
+			}
+
+			if (p < pattern.size()) {
+				if (const std::size_t width{ MatchOne(pattern.substr(p), text[t]) }; width != 0) {
+					p += width;
+					++t;
+					continue;
+				}
+			}
+
+			// Let the last '*' take one more character and try again from there.
+			if (starPattern == std::string_view::npos)
+				return false;
+			p = starPattern;
+			t = ++starText;
+		}
+
+		while (p < pattern.size() && pattern[p] == '*')
+			++p;
+
+		return p == pattern.size();
+	}
+}
+
+PathFilter::PathFilter(const std::vector<std::string>& includePatterns, const std::vector<std::string>& excludePatterns)
+{
+	for (const auto& text : excludePatterns) {
+		Pattern pattern{ Compile(text) };
+		if (pattern.segments.empty())
+			continue;
+
+		// An unanchored plain name needs no matching at all, only a lookup per segment.
+		if (pattern.segments.size() == 2 && pattern.segments[0].anyDepth && pattern.segments[1].literal) {
+			(pattern.directoryOnly ? excludedDirectoryNames : excludedNames).insert(pattern.segments[1].text);
+			continue;
+		}
+
+		excludes.push_back(std::move(pattern));
+	}
+
+	for (const auto& text : includePatterns) {
+		Pattern pattern{ Compile(text) };
+		if (!pattern.segments.empty())
+			includes.push_back(std::move(pattern));
+	}
+}
+
+PathFilter::Pattern PathFilter::Compile(std::string_view text)
+{
+	Pattern pattern{};
+
+	while (text.ends_with('/')) {
+		pattern.directoryOnly = true;
+		text.remove_suffix(1);
+	}
+
+	// Like .gitignore, only a slash before the end anchors the pattern to the root.
+	const bool anchored{ text.find('/') != std::string_view::npos };
+	if (!anchored && !text.empty())
+		pattern.segments.push_back(Segment{ "**", false, true });
+
+	for (const auto segment : Split(text)) {
+		if (segment == "**") {
+			if (pattern.segments.empty() || !pattern.segments.back().anyDepth)
+				pattern.segments.push_back(Segment{ "**", false, true });
+			continue;
+		}
+
+		const bool literal{ segment.find_first_of("*?[\\") == std::string_view::npos };
+		pattern.segments.push_back(Segment{ std::string(segment), literal, false });
+	}
+
+	return pattern;
+}
+
+bool PathFilter::MatchFrom(const Pattern& pattern, std::size_t first, const std::vector<std::string_view>& path, std::size_t next, std::size_t end)
+{
+	if (first == pattern.segments.size())
+		return next == end;
+
+	const Segment& segment{ pattern.segments[first] };
+	if (segment.anyDepth) {
+		for (std::size_t skipped = next; skipped <= end; ++skipped) {
+			if (MatchFrom(pattern, first + 1, path, skipped, end))
+				return true;
+		}
+		return false;
+	}
+
+	if (next == end)
+		return false;
+
+	const bool same{ segment.literal ? segment.text == path[next] : MatchSegment(segment.text, path[next]) };
+	return same && MatchFrom(pattern, first + 1, path, next + 1, end);
+}
+
+bool PathFilter::MatchesPrefix(const Pattern& pattern, const std::vector<std::string_view>& path, bool directory)
+{
+	// Every parent of the path is a directory; the path itself only is when directory says so.
+	for (std::size_t end = 1; end <= path.size(); ++end) {
+		if (pattern.directoryOnly && end == path.size() && !directory)
+			continue;
+		if (MatchFrom(pattern, 0, path, 0, end))
+			return true;
+	}
+
+	return false;
+}
+
+bool PathFilter::CouldMatchBelow(const Pattern& pattern, const std::vector<std::string_view>& directory)
+{
+	std::size_t first{ 0 };
+
+	for (const auto name : directory) {
+		// The pattern ran out on a parent, which MatchesPrefix already covers.
+		if (first == pattern.segments.size())
+			return false;
+
+		const Segment& segment{ pattern.segments[first] };
+		if (segment.anyDepth)
+			return true;
+		if (!(segment.literal ? segment.text == name : MatchSegment(segment.text, name)))
+			return false;
+
+		++first;
+	}
+
+	return first < pattern.segments.size();
+}
+
+bool PathFilter::Excluded(const std::vector<std::string_view>& path, bool directory) const
+{
+	for (std::size_t i = 0; i < path.size(); ++i) {
+		if (excludedNames.contains(path[i]))
+			return true;
+		if ((i + 1 < path.size() || directory) && excludedDirectoryNames.contains(path[i]))
+			return true;
+	}
+
+	return std::ranges::any_of(excludes, [&](const Pattern& pattern) { return MatchesPrefix(pattern, path, directory); });
+}
+
+bool PathFilter::Empty() const
+{
+	return excludedNames.empty() && excludedDirectoryNames.empty() && excludes.empty() && includes.empty();
+}
+
+bool PathFilter::Admits(std::string_view path) const
+{
+	if (Empty())
+		return true;
+
+	const auto segments{ Split(path) };
+
+	if (Excluded(segments, false))
+		return false;
+
+	return includes.empty() || std::ranges::any_of(includes, [&](const Pattern& pattern) { return MatchesPrefix(pattern, segments, false); });
+}
+
+bool PathFilter::Enters(std::string_view directory) const
+{
+	if (Empty())
+		return true;
+
+	const auto segments{ Split(directory) };
+
+	if (Excluded(segments, true))
+		return false;
+
+	return includes.empty() || std::ranges::any_of(includes, [&](const Pattern& pattern) {
+		return MatchesPrefix(pattern, segments, true) || CouldMatchBelow(pattern, segments);
+	});
+}
+
+std::vector<std::string> PathFilter::ListPrefixes() const
+{
+	std::vector<std::string> prefixes{};
+
+	for (const auto& pattern : includes) {
+		// The literal directories an include starts with; a wildcard or "**" ends the part a listing can use.
+		std::string prefix{};
+		for (const auto& segment : pattern.segments) {
+			if (!segment.literal)
+				break;
+			if (!prefix.empty())
+				prefix += '/';
+			prefix += segment.text;
+		}
+
+		const bool whole{ std::ranges::all_of(pattern.segments, &Segment::literal) };
+		if ((!whole || pattern.directoryOnly) && !prefix.empty())
+			prefix += '/';
+
+		if (prefix.empty())
+			return { "" };
+
+		prefixes.push_back(std::move(prefix));
+	}
+
+	if (prefixes.empty())
+		return { "" };
+
+	// A prefix inside another one is already listed with it.
+	std::sort(prefixes.begin(), prefixes.end());
+	std::vector<std::string> covering{};
+	for (auto& prefix : prefixes) {
+		if (covering.empty() || !prefix.starts_with(covering.back()))
+			covering.push_back(std::move(prefix));
+	}
+
+	return covering;
+}
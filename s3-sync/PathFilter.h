@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <cstddef>
+
+// gitignore-style include and exclude patterns, compiled once and matched against '/'-separated
+// relative paths. A pattern without a '/' matches a name at any depth, one with a leading or inner
+// '/' is anchored to the root, a trailing '/' only matches directories, and "**" spans directories.
+// Matching a directory matches everything under it, so an excluded directory is never entered.
+class PathFilter {
+private:
+	struct Segment {
+		std::string text{};
+		bool literal{ true };
+		// "**": any number of directories, including none.
+		bool anyDepth{ false };
+	};
+
+	struct Pattern {
+		std::vector<Segment> segments{};
+		bool directoryOnly{ false };
+	};
+
+	struct NameHash {
+		using is_transparent = void;
+		std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+	};
+
+	// Plain names like node_modules or .git are the common case, and are looked up per path segment.
+	std::unordered_set<std::string, NameHash, std::equal_to<>> excludedNames;
+	std::unordered_set<std::string, NameHash, std::equal_to<>> excludedDirectoryNames;
+	std::vector<Pattern> excludes;
+	std::vector<Pattern> includes;
+
+	static Pattern Compile(std::string_view pattern);
+	// Whether the pattern from segment first on matches path[next, end).
+	static bool MatchFrom(const Pattern& pattern, std::size_t first, const std::vector<std::string_view>& path, std::size_t next, std::size_t end);
+	static bool MatchesPrefix(const Pattern& pattern, const std::vector<std::string_view>& path, bool directory);
+	static bool CouldMatchBelow(const Pattern& pattern, const std::vector<std::string_view>& directory);
+
+	bool Excluded(const std::vector<std::string_view>& path, bool directory) const;
+
+public:
+	PathFilter() = default;
+	PathFilter(const std::vector<std::string>& includePatterns, const std::vector<std::string>& excludePatterns);
+
+	bool Empty() const;
+	// A file passes when neither it nor a parent is excluded and, with includes, it or a parent is included.
+	bool Admits(std::string_view path) const;
+	// False when nothing under the directory can pass, so scans and listings skip it whole.
+	bool Enters(std::string_view directory) const;
+	// Relative prefixes that cover everything the includes can match, "" when that's everything.
+	std::vector<std::string> ListPrefixes() const;
+};
@@ -0,0 +1,124 @@
+#include "RemoteIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <functional>
+
+namespace {
+	constexpr std::size_t blockSize{ 1024 * 1024 };
+}
+
+const char* RemoteIndex::Store(std::string_view key, std::string_view eTag)
+{
+	const std::size_t length{ key.size() + eTag.size() };
+
+	// An entry never straddles two blocks; the rest of a full one is left unused.
+	if (blocks.empty() || blockUsed + length > blockCapacity) {
+		blockCapacity = std::max(blockSize, length);
+		blocks.push_back(std::make_unique_for_overwrite<char[]>(blockCapacity));
+		blockUsed = 0;
+	}
+
+	char* text{ blocks.back().get() + blockUsed };
+	std::memcpy(text, key.data(), key.size());
+	std::memcpy(text + key.size(), eTag.data(), eTag.size());
+	blockUsed += length;
+
+	return text;
+}
+
+void RemoteIndex::Grow()
+{
+	slots.assign(std::max<std::size_t>(slots.size() * 2, 1024), 0);
+
+	for (std::size_t i = 0; i < entries.size(); ++i) {
+		const Entry& entry{ entries[i] };
+		slots[Slot({ entry.text, entry.keyLength })] = static_cast<std::uint32_t>(i + 1);
+	}
+}
+
+std::size_t RemoteIndex::Slot(std::string_view key) const
+{
+	// Linear probing over a power-of-two table kept at most 70% full.
+	const std::size_t mask{ slots.size() - 1 };
+
+	for (std::size_t slot = std::hash<std::string_view>{}(key) & mask; ; slot = (slot + 1) & mask) {
+		if (slots[slot] == 0)
+			return slot;
+
+		const Entry& entry{ entries[slots[slot] - 1] };
+		if (entry.keyLength == key.size() && std::memcmp(entry.text, key.data(), key.size()) == 0)
+			return slot;
+	}
+}
+
+void RemoteIndex::Add(const Aws::Vector<Aws::S3::Model::Object>& page)
+{
+	for (const auto& object : page) {
+		if ((entries.size() + 1) * 10 > slots.size() * 7)
+			Grow();
+
+		const std::string_view key{ object.GetKey() };
+		const std::string_view eTag{ object.GetETag() };
+
+		Entry entry{ Store(key, eTag), static_cast<std::uint64_t>(object.GetSize()), object.GetLastModified().Seconds(), static_cast<std::uint32_t>(key.size()), static_cast<std::uint32_t>(eTag.size()) };
+
+		const std::size_t slot{ Slot(key) };
+		if (slots[slot] != 0) {
+			entries[slots[slot] - 1] = entry;
+			continue;
+		}
+
+		entries.push_back(entry);
+		slots[slot] = static_cast<std::uint32_t>(entries.size());
+	}
+}
+
+std::optional<RemoteObject> RemoteIndex::Find(std::string_view key) const
+{
+	if (entries.empty())
+		return std::nullopt;
+
+	const std::uint32_t index{ slots[Slot(key)] };
+	if (index == 0)
+		return std::nullopt;
+
+	const Entry& entry{ entries[index - 1] };
+	return RemoteObject{
+		{ entry.text, entry.keyLength },
+		entry.size,
+		entry.lastModified,
+		{ entry.text + entry.keyLength, entry.eTagLength }
+	};
+}
+
+void RemoteIndex::ForEachSorted(const std::function<void(const RemoteObject&)>& onObject) const
+{
+	auto keyOf{ [this](std::uint32_t index) {
+		return std::string_view{ entries[index].text, entries[index].keyLength };
+	} };
+
+	std::vector<std::uint32_t> order(entries.size());
+	std::iota(order.begin(), order.end(), 0u);
+
+	// A sequential listing is already in order; only a fanned-out one interleaves its prefixes.
+	auto byKey{ [&](std::uint32_t a, std::uint32_t b) { return keyOf(a) < keyOf(b); } };
+	if (!std::is_sorted(order.begin(), order.end(), byKey))
+		std::sort(order.begin(), order.end(), byKey);
+
+	for (const std::uint32_t index : order) {
+		const Entry& entry{ entries[index] };
+		onObject(RemoteObject{
+			{ entry.text, entry.keyLength },
+			entry.size,
+			entry.lastModified,
+			{ entry.text + entry.keyLength, entry.eTagLength }
+		});
+	}
+}
+
+std::size_t RemoteIndex::Size() const
+{
+	return entries.size();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <aws/s3/model/Object.h>
+#include <aws/core/utils/memory/stl/AWSVector.h>
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// The parts of a listed object that put and copy compare against.
+struct RemoteObject {
+	std::string_view key{};
+	std::uint64_t size{ 0 };
+	// Seconds since the Unix epoch, as precise as a listing reports it.
+	std::int64_t lastModified{ 0 };
+	std::string_view eTag{};
+};
+
+// Listing of a bucket kept as compactly as lookups allow: keys and ETags are packed back to back
+// in large blocks and found through a flat open-addressing table, so millions of objects cost
+// tens of bytes each instead of a full SDK Object with its own heap strings.
+class RemoteIndex {
+private:
+	struct Entry {
+		const char* text{ nullptr };
+		std::uint64_t size{ 0 };
+		std::int64_t lastModified{ 0 };
+		std::uint32_t keyLength{ 0 };
+		std::uint32_t eTagLength{ 0 };
+	};
+
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::size_t blockUsed{ 0 };
+	std::size_t blockCapacity{ 0 };
+
+	std::vector<Entry> entries;
+	// Entry index + 1 per slot, 0 for an empty one.
+	std::vector<std::uint32_t> slots;
+
+	const char* Store(std::string_view key, std::string_view eTag);
+	void Grow();
+	std::size_t Slot(std::string_view key) const;
+
+public:
+	// Copies what it needs out of one listing page; the page can be dropped right after.
+	void Add(const Aws::Vector<Aws::S3::Model::Object>& page);
+
+	std::optional<RemoteObject> Find(std::string_view key) const;
+	// Every object in key order, the order S3 lists them in, for merging against another sorted sequence.
+	void ForEachSorted(const std::function<void(const RemoteObject&)>& onObject) const;
+	std::size_t Size() const;
+};
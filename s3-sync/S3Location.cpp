@@ -0,0 +1,40 @@
+#include "S3Location.h"
+
+S3Location S3Location::Parse(std::string_view location)
+{
+	S3Location result{};
+
+	if (location.starts_with("s3://"))
+		location.remove_prefix(5);
+
+	auto separator{ location.find('/') };
+	result.bucket = location.substr(0, separator);
+	if (separator == std::string_view::npos)
+		return result;
+
+	std::string_view prefix{ location.substr(separator + 1) };
+	while (prefix.starts_with('/'))
+		prefix.remove_prefix(1);
+
+	// A prefix always names a "directory", so "bucket/logs" never matches "logs-old/...".
+	result.prefix = prefix;
+	if (!result.prefix.empty() && !result.prefix.ends_with('/'))
+		result.prefix += '/';
+
+	return result;
+}
+
+std::string S3Location::KeyFor(std::string_view relativeKey) const
+{
+	std::string key{ prefix };
+	key += relativeKey;
+	return key;
+}
+
+std::string_view S3Location::RelativeKey(std::string_view key) const
+{
+	if (key.starts_with(prefix))
+		key.remove_prefix(prefix.size());
+
+	return key;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// A bucket plus an optional key prefix, written as "bucket" or "bucket/some/prefix".
+struct S3Location {
+	std::string bucket{};
+	// Empty, or ends with '/'.
+	std::string prefix{};
+
+	static S3Location Parse(std::string_view location);
+
+	std::string KeyFor(std::string_view relativeKey) const;
+	std::string_view RelativeKey(std::string_view key) const;
+};
@@ -0,0 +1,47 @@
+#include "Serialization.h"
+
+#include <algorithm>
+
+void Serialization::WriteString(std::ostream& out, std::string_view value)
+{
+	WriteValue(out, static_cast<std::uint32_t>(value.size()));
+	out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+void Serialization::WriteString(std::string& out, std::string_view value)
+{
+	WriteValue(out, static_cast<std::uint32_t>(value.size()));
+	out.append(value);
+}
+
+bool Serialization::ReadString(std::istream& in, std::string& value)
+{
+	// Grown as the bytes arrive, so a corrupt length fails on a short read instead of allocating up to 4 GiB.
+	constexpr std::size_t step{ 64 * 1024 };
+
+	std::uint32_t length{ 0 };
+	if (!ReadValue(in, length))
+		return false;
+
+	value.clear();
+	while (value.size() < length) {
+		const std::size_t offset{ value.size() };
+		const std::size_t size{ std::min<std::size_t>(length - offset, step) };
+		value.resize(offset + size);
+		if (!in.read(value.data() + offset, static_cast<std::streamsize>(size)))
+			return false;
+	}
+
+	return true;
+}
+
+std::uint64_t Serialization::HashName(std::string_view value)
+{
+	std::uint64_t hash{ 14695981039346656037ull };
+	for (unsigned char c : value) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+
+// Binary encoding shared by the state files and the objects s3-sync writes to the bucket:
+// values in host byte order, strings as a 32-bit length followed by their bytes.
+namespace Serialization {
+	template<typename T>
+	void WriteValue(std::ostream& out, T value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template<typename T>
+	void WriteValue(std::string& out, T value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template<typename T>
+	bool ReadValue(std::istream& in, T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+	}
+
+	void WriteString(std::ostream& out, std::string_view value);
+	void WriteString(std::string& out, std::string_view value);
+	// False on a short read, without trusting the stored length for the allocation.
+	bool ReadString(std::istream& in, std::string& value);
+
+	// FNV-1a, so file names built from it stay the same across builds and platforms.
+	std::uint64_t HashName(std::string_view value);
+}
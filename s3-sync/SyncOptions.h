@@ -0,0 +1,90 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+enum class CompareMode {
+	Timestamp,
+	Checksum
+};
+
+enum class Engine {
+	Classic,
+	Crt
+};
+
+struct SyncOptions {
+	// S3-compatible endpoint to talk to instead of AWS, e.g. http://localhost:9000.
+	std::string endpoint{};
+
+	// S3 client that whole-object puts and gets go through; Crt splits them into parts and connections itself.
+	Engine engine{ Engine::Classic };
+	// Gbps the CRT client sizes its connection pool for.
+	std::uint64_t throughputTarget{ 10 };
+
+	// HTTP client tuning; 0 keeps one connection per maxWorkers and the SDK's own timeouts and probe interval.
+	int maxConnections{ 0 };
+	std::chrono::milliseconds connectTimeout{ 0 };
+	std::chrono::milliseconds requestTimeout{ 0 };
+	bool tcpKeepAlive{ true };
+	std::chrono::seconds keepAliveInterval{ 0 };
+
+	// Requests in flight across put, get and delete to start with; the limit adapts up to maxWorkers.
+	int workers{ 8 };
+	int maxWorkers{ 64 };
+	// Attempts after the first for throttled or transient failures.
+	int retries{ 5 };
+	// Levels of "/" prefixes listed in parallel; 0 lists the bucket sequentially.
+	int listFanoutDepth{ 0 };
+
+	// Files at or above this size are uploaded in parts and downloaded in ranges.
+	std::uint64_t multipartThreshold{ 64ull * 1024 * 1024 };
+	std::uint64_t partSize{ 16ull * 1024 * 1024 };
+	int partConcurrency{ 4 };
+	// Journal multipart uploads and ranged downloads in the state directory so an interrupted run picks up where it stopped.
+	bool resume{ true };
+	// Read request bodies and write response bodies through io_uring when the kernel allows it.
+	bool ioUring{ true };
+
+	// Keep a per (directory, bucket) manifest so no-op syncs skip the listing and the stat calls.
+	bool useManifest{ false };
+	bool reconcile{ false };
+	std::uint64_t reconcileInterval{ 16 };
+	std::filesystem::path stateDirectory{};
+
+	CompareMode compareMode{ CompareMode::Timestamp };
+
+	// Pack files below the threshold into bundle objects of roughly bundleSize bytes.
+	bool bundle{ false };
+	std::uint64_t bundleThreshold{ 1024ull * 1024 };
+	std::uint64_t bundleSize{ 64ull * 1024 * 1024 };
+
+	// Bytes per second across every transfer, 0 for no cap; the control file can change them mid-sync.
+	std::uint64_t uploadLimit{ 0 };
+	std::uint64_t downloadLimit{ 0 };
+	std::filesystem::path limitFile{};
+
+	// Store files at or above chunkThreshold as content-defined chunks of about chunkSize bytes, uploading only new chunks.
+	bool chunk{ false };
+	std::uint64_t chunkThreshold{ 64ull * 1024 * 1024 };
+	std::uint64_t chunkSize{ 1024ull * 1024 };
+
+	// Upload with zstd where it pays off; compressed objects are always decompressed on get.
+	bool compress{ false };
+	int compressionLevel{ 3 };
+
+	// Delete what the source no longer has: objects on put and copy, local files on get.
+	bool mirror{ false };
+	// Print the transfers and deletions a run would make without making any of them.
+	bool dryRun{ false };
+
+	// gitignore-style patterns on paths relative to the synced directory or prefix; see PathFilter.
+	std::vector<std::string> includes{};
+	std::vector<std::string> excludes{};
+
+	// watch uploads a batch once the tree has been quiet this long, and does a full sync every watchReconcile (0 = never).
+	std::chrono::milliseconds watchDelay{ 500 };
+	std::chrono::seconds watchReconcile{ 3600 };
+};
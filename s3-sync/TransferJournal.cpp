@@ -0,0 +1,162 @@
+#include "TransferJournal.h"
+#include "Serialization.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+namespace {
+	constexpr std::array<char, 4> magic{ 'S', '3', 'S', 'J' };
+	constexpr std::uint32_t version{ 1 };
+
+	using Serialization::WriteValue;
+	using Serialization::ReadValue;
+	using Serialization::WriteString;
+	using Serialization::ReadString;
+	using Serialization::HashName;
+}
+
+TransferJournal::TransferJournal(std::filesystem::path path)
+	: path{ std::move(path) }
+{
+}
+
+std::filesystem::path TransferJournal::PathFor(const std::filesystem::path& stateDirectory, std::string_view kind, const std::filesystem::path& localPath, std::string_view bucket, std::string_view key)
+{
+	std::error_code ec{};
+	auto absolutePath{ std::filesystem::weakly_canonical(localPath, ec) };
+	if (ec)
+		absolutePath = std::filesystem::absolute(localPath);
+
+	std::string identity{ kind };
+	identity += '\n';
+	identity += absolutePath.generic_string();
+	identity += '\n';
+	identity += bucket;
+	identity += '\n';
+	identity += key;
+
+	std::array<char, 16> name{};
+	auto [end, error] { std::to_chars(name.data(), name.data() + name.size(), HashName(identity), 16) };
+
+	return stateDirectory / "journals" / (std::string(name.data(), end) + ".journal");
+}
+
+bool TransferJournal::Load()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	header = {};
+	parts.clear();
+	validLength = 0;
+
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open())
+		return false;
+
+	std::array<char, 4> fileMagic{};
+	std::uint32_t fileVersion{ 0 };
+
+	in.read(fileMagic.data(), fileMagic.size());
+	if (!in || fileMagic != magic || !ReadValue(in, fileVersion) || fileVersion != version
+		|| !ReadString(in, header.bucket) || !ReadString(in, header.key) || !ReadValue(in, header.size)
+		|| !ReadValue(in, header.modifiedTime) || !ReadValue(in, header.partSize) || !ReadString(in, header.id))
+	{
+		header = {};
+		return false;
+	}
+
+	validLength = static_cast<std::uint64_t>(in.tellg());
+
+	// Parts are appended as they finish; a crash mid-append only loses the record being written.
+	for (;;) {
+		std::uint32_t part{ 0 };
+		std::string eTag{};
+		if (!ReadValue(in, part) || !ReadString(in, eTag))
+			break;
+
+		parts.insert_or_assign(part, std::move(eTag));
+		validLength = static_cast<std::uint64_t>(in.tellg());
+	}
+
+	return true;
+}
+
+bool TransferJournal::Begin(const JournalHeader& header)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	this->header = header;
+	parts.clear();
+
+	std::error_code ec{};
+	std::filesystem::create_directories(path.parent_path(), ec);
+	if (ec)
+		return false;
+
+	out.close();
+	out.open(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write(magic.data(), magic.size());
+	WriteValue(out, version);
+	WriteString(out, header.bucket);
+	WriteString(out, header.key);
+	WriteValue(out, header.size);
+	WriteValue(out, header.modifiedTime);
+	WriteValue(out, header.partSize);
+	WriteString(out, header.id);
+
+	return static_cast<bool>(out.flush());
+}
+
+bool TransferJournal::Continue()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::error_code ec{};
+	std::filesystem::resize_file(path, validLength, ec);
+	if (ec)
+		return false;
+
+	out.close();
+	out.open(path, std::ios::binary | std::ios::app);
+	return out.is_open();
+}
+
+bool TransferJournal::Record(std::uint32_t part, std::string_view eTag)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!out.is_open())
+		return false;
+
+	WriteValue(out, part);
+	WriteString(out, eTag);
+	parts.insert_or_assign(part, std::string(eTag));
+
+	// Flushed per part, so a killed process loses at most the parts still in flight.
+	return static_cast<bool>(out.flush());
+}
+
+void TransferJournal::Discard()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	out.close();
+	parts.clear();
+
+	std::error_code ec{};
+	std::filesystem::remove(path, ec);
+}
+
+const JournalHeader& TransferJournal::Header() const
+{
+	return header;
+}
+
+const std::map<std::uint32_t, std::string>& TransferJournal::Parts() const
+{
+	return parts;
+}
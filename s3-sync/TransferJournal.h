@@ -0,0 +1,49 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// What a journal was written for; a rerun only resumes if all of it still matches.
+struct JournalHeader {
+	std::string bucket{};
+	std::string key{};
+	std::uint64_t size{ 0 };
+	// Unix nanoseconds of the local file for uploads, 0 for downloads.
+	std::int64_t modifiedTime{ 0 };
+	std::uint64_t partSize{ 0 };
+	// Multipart upload ID for uploads, the object's ETag for downloads.
+	std::string id{};
+};
+
+// Append-only record of the parts (or ranges) of one transfer that already made it, so an interrupted run can resume.
+class TransferJournal {
+private:
+	std::filesystem::path path;
+	JournalHeader header;
+	std::map<std::uint32_t, std::string> parts;
+	// Bytes up to the last complete record; a record torn by a crash is cut off before appending again.
+	std::uint64_t validLength{ 0 };
+	std::ofstream out;
+	std::mutex mutex;
+
+public:
+	explicit TransferJournal(std::filesystem::path path);
+
+	static std::filesystem::path PathFor(const std::filesystem::path& stateDirectory, std::string_view kind, const std::filesystem::path& localPath, std::string_view bucket, std::string_view key);
+
+	// Loads whatever a previous run left behind, without judging whether it still applies.
+	bool Load();
+	// Starts over with a fresh header; earlier parts are forgotten.
+	bool Begin(const JournalHeader& header);
+	// Keeps appending to the loaded journal.
+	bool Continue();
+	bool Record(std::uint32_t part, std::string_view eTag = {});
+	void Discard();
+
+	const JournalHeader& Header() const;
+	const std::map<std::uint32_t, std::string>& Parts() const;
+};
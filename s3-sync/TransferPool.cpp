@@ -0,0 +1,165 @@
+#include "TransferPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+	thread_local const TransferPool* currentPool{ nullptr };
+	thread_local std::size_t currentWorker{ 0 };
+}
+
+TransferPool::TransferPool(int workerCount, std::size_t queueCapacity)
+	: capacity{ std::max<std::size_t>(queueCapacity, 1) }
+{
+	const std::size_t count{ static_cast<std::size_t>(std::max(workerCount, 1)) };
+
+	workers.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+		workers.push_back(std::make_unique<Worker>());
+
+	threads.reserve(count);
+	for (std::size_t i = 0; i < count; ++i)
+		threads.emplace_back([this, i](std::stop_token stopToken) { Run(stopToken, i); });
+}
+
+TransferPool::~TransferPool()
+{
+	for (auto& thread : threads)
+		thread.request_stop();
+
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+	}
+	workAvailable.notify_all();
+
+	threads.clear();
+}
+
+void TransferPool::Submit(Group& group, std::function<void()> task)
+{
+	group.outstanding.fetch_add(1);
+
+	auto wrapped{ [&group, task = std::move(task)]() {
+		task();
+
+		// Decrement under the lock so Wait can't return and destroy the group mid-notify.
+		std::lock_guard<std::mutex> lock(group.mutex);
+		group.outstanding.fetch_sub(1);
+		group.done.notify_all();
+	} };
+
+	const bool onWorker{ IsWorkerThread() };
+
+	// The check and the reservation happen under one lock, so concurrent submitters can't overfill the queue.
+	{
+		std::unique_lock<std::mutex> lock(stateMutex);
+		if (queued.load() >= capacity) {
+			// A worker blocking on a full queue could wait on itself, so it runs the task inline instead.
+			if (onWorker) {
+				lock.unlock();
+				wrapped();
+				return;
+			}
+
+			spaceAvailable.wait(lock, [this]() { return queued.load() < capacity; });
+		}
+
+		queued.fetch_add(1);
+	}
+
+	// Workers keep their own subtasks local; everything else is spread round-robin.
+	const std::size_t index{ onWorker ? currentWorker : nextWorker.fetch_add(1) % workers.size() };
+	{
+		std::lock_guard<std::mutex> lock(workers[index]->mutex);
+		workers[index]->tasks.push_back(std::move(wrapped));
+	}
+	workAvailable.notify_one();
+}
+
+void TransferPool::Wait(Group& group, std::size_t maxOutstanding)
+{
+	const std::size_t preferred{ IsWorkerThread() ? currentWorker : 0 };
+
+	while (group.outstanding.load() > maxOutstanding) {
+		if (RunOne(preferred))
+			continue;
+
+		std::unique_lock<std::mutex> lock(group.mutex);
+		group.done.wait_for(lock, std::chrono::milliseconds(5), [&group, maxOutstanding]() {
+			return group.outstanding.load() <= maxOutstanding;
+		});
+	}
+
+	std::lock_guard<std::mutex> lock(group.mutex);
+}
+
+int TransferPool::WorkerCount() const
+{
+	return static_cast<int>(workers.size());
+}
+
+void TransferPool::Run(std::stop_token stopToken, std::size_t index)
+{
+	currentPool = this;
+	currentWorker = index;
+
+	while (!stopToken.stop_requested()) {
+		if (RunOne(index))
+			continue;
+
+		std::unique_lock<std::mutex> lock(stateMutex);
+		workAvailable.wait(lock, [this, &stopToken]() {
+			return queued.load() > 0 || stopToken.stop_requested();
+		});
+	}
+}
+
+bool TransferPool::RunOne(std::size_t preferred)
+{
+	auto task{ Take(preferred) };
+	if (!task)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		queued.fetch_sub(1);
+	}
+	spaceAvailable.notify_one();
+
+	task();
+	return true;
+}
+
+std::function<void()> TransferPool::Take(std::size_t preferred)
+{
+	std::function<void()> task{};
+
+	// Newest local work first, which keeps a file's parts together on the worker that split it.
+	{
+		auto& own{ *workers[preferred] };
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return task;
+		}
+	}
+
+	// Otherwise steal the oldest task from someone else.
+	for (std::size_t offset = 1; offset < workers.size(); ++offset) {
+		auto& victim{ *workers[(preferred + offset) % workers.size()] };
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return task;
+		}
+	}
+
+	return task;
+}
+
+bool TransferPool::IsWorkerThread() const
+{
+	return currentPool == this;
+}
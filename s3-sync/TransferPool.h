@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers shared by every transfer. Each worker owns a deque and steals from
+// the others when it runs dry; submissions block once the queue is full, so memory stays
+// bounded no matter how many files a job has.
+class TransferPool {
+public:
+	// Tracks the tasks belonging to one job (a sync, or the parts of one file).
+	class Group {
+	private:
+		friend class TransferPool;
+
+		std::atomic<std::size_t> outstanding{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+private:
+	struct Worker {
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::jthread> threads;
+	std::size_t capacity;
+
+	std::atomic<std::size_t> queued{ 0 };
+	std::atomic<std::size_t> nextWorker{ 0 };
+	std::mutex stateMutex;
+	std::condition_variable workAvailable;
+	std::condition_variable spaceAvailable;
+
+public:
+	TransferPool(int workerCount, std::size_t queueCapacity);
+	~TransferPool();
+
+	TransferPool(const TransferPool&) = delete;
+	TransferPool& operator=(const TransferPool&) = delete;
+
+	void Submit(Group& group, std::function<void()> task);
+	// Blocks until at most maxOutstanding tasks of the group are left, running queued work meanwhile.
+	void Wait(Group& group, std::size_t maxOutstanding = 0);
+
+	int WorkerCount() const;
+
+private:
+	void Run(std::stop_token stopToken, std::size_t index);
+	bool RunOne(std::size_t preferred);
+	std::function<void()> Take(std::size_t preferred);
+	bool IsWorkerThread() const;
+};
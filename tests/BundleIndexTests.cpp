@@ -0,0 +1,136 @@
+#include "BundleIndex.h"
+#include "Test.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace {
+	template<typename T>
+	void Append(std::string& out, T value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void AppendString(std::string& out, std::string_view value)
+	{
+		Append(out, static_cast<std::uint32_t>(value.size()));
+		out += value;
+	}
+
+	// An index holding one entry with the given path.
+	std::string IndexWithPath(std::string_view path)
+	{
+		std::string data{ "S3SB" };
+		Append(data, std::uint32_t{ 1 });
+		Append(data, std::uint64_t{ 1 });
+		AppendString(data, path);
+		AppendString(data, ".s3sync/bundles/1.bundle");
+		Append(data, std::uint64_t{ 0 });
+		Append(data, std::uint64_t{ 5 });
+		Append(data, std::int64_t{ 0 });
+		return data;
+	}
+
+	bool Parses(const std::string& data)
+	{
+		BundleIndex index{};
+		std::istringstream in{ data };
+		return index.Parse(in).has_value();
+	}
+}
+
+TEST(RoundTrip)
+{
+	BundleIndex index{};
+	index.Update("a.txt", BundleEntry{ ".s3sync/bundles/1.bundle", 0, 5, 1700000000000000000 });
+	index.Update("dir/b.txt", BundleEntry{ ".s3sync/bundles/1.bundle", 5, 7, -1 });
+	index.Update("dir/c.txt", BundleEntry{ ".s3sync/bundles/2.bundle", 0, 3, 0 });
+
+	BundleIndex parsed{};
+	std::istringstream in{ index.Serialize() };
+	CHECK(parsed.Parse(in).has_value());
+	CHECK(parsed.Entries().size() == 3);
+
+	const BundleEntry* b{ parsed.Find("dir/b.txt") };
+	CHECK(b && b->bundle == ".s3sync/bundles/1.bundle" && b->offset == 5 && b->size == 7 && b->modifiedTime == -1);
+	CHECK(parsed.Find("missing") == nullptr);
+}
+
+TEST(ReferencedBundlesFollowErase)
+{
+	BundleIndex index{};
+	index.Update("a", BundleEntry{ "b1", 0, 1, 0 });
+	index.Update("b", BundleEntry{ "b1", 1, 1, 0 });
+	index.Update("c", BundleEntry{ "b2", 0, 1, 0 });
+
+	CHECK((index.ReferencedBundles() == std::set<std::string>{ "b1", "b2" }));
+
+	index.Erase("c");
+	CHECK((index.ReferencedBundles() == std::set<std::string>{ "b1" }));
+}
+
+TEST(AcceptsOrdinaryPaths)
+{
+	CHECK(Parses(IndexWithPath("a.txt")));
+	CHECK(Parses(IndexWithPath("dir/sub/a.txt")));
+	CHECK(Parses(IndexWithPath("dir/..hidden")));
+}
+
+TEST(RejectsPathsThatLeaveTheDestination)
+{
+	CHECK(!Parses(IndexWithPath("")));
+	CHECK(!Parses(IndexWithPath("../escape")));
+	CHECK(!Parses(IndexWithPath("dir/../../escape")));
+	CHECK(!Parses(IndexWithPath("/etc/passwd")));
+	CHECK(!Parses(IndexWithPath("dir\\..\\escape")));
+}
+
+TEST(RejectsTruncation)
+{
+	const std::string data{ IndexWithPath("a.txt") };
+
+	bool allRejected{ true };
+	for (std::size_t length = 0; length < data.size(); ++length)
+		allRejected = allRejected && !Parses(data.substr(0, length));
+	CHECK(allRejected);
+}
+
+TEST(RejectsHugeCountsAndLengths)
+{
+	std::string hugeCount{ "S3SB" };
+	Append(hugeCount, std::uint32_t{ 1 });
+	Append(hugeCount, std::uint64_t{ 1ull << 62 });
+	CHECK(!Parses(hugeCount));
+
+	std::string hugeLength{ "S3SB" };
+	Append(hugeLength, std::uint32_t{ 1 });
+	Append(hugeLength, std::uint64_t{ 1 });
+	Append(hugeLength, std::uint32_t{ 0xfffffff0 });
+	hugeLength += "a.txt";
+	CHECK(!Parses(hugeLength));
+}
+
+TEST(FailedParseLeavesNoEntries)
+{
+	BundleIndex index{};
+	index.Update("stale", BundleEntry{ "b", 0, 1, 0 });
+
+	std::istringstream in{ IndexWithPath("../escape") };
+	CHECK(!index.Parse(in).has_value());
+	CHECK(index.Entries().empty());
+}
+
+TEST(UnixTimeRoundTrip)
+{
+	const auto now{ std::filesystem::file_time_type::clock::now() };
+	const std::int64_t unix{ BundleIndex::ToUnixTime(now) };
+
+	CHECK(BundleIndex::ToUnixTime(BundleIndex::FromUnixTime(unix)) == unix);
+	CHECK(BundleIndex::ToUnixTime(BundleIndex::FromUnixTime(0)) == 0);
+}
+
+int main()
+{
+	return Test::RunAll();
+}
@@ -0,0 +1,111 @@
+#include "Checksum.h"
+#include "Test.h"
+
+#include <aws/core/utils/HashingUtils.h>
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace {
+	constexpr std::uint64_t mebibyte{ 1024 * 1024 };
+
+	std::string Md5Hex(const std::string& data)
+	{
+		return std::string{ Aws::Utils::HashingUtils::HexEncode(Aws::Utils::HashingUtils::CalculateMD5(Aws::String{ data })) };
+	}
+
+	std::string Md5Raw(const std::string& data)
+	{
+		const auto digest{ Aws::Utils::HashingUtils::CalculateMD5(Aws::String{ data }) };
+		return std::string(reinterpret_cast<const char*>(digest.GetUnderlyingData()), digest.GetLength());
+	}
+
+	std::string WriteFile(const std::filesystem::path& path, std::size_t size)
+	{
+		std::mt19937_64 generator{ size };
+		std::string data(size, '\0');
+		for (auto& c : data)
+			c = static_cast<char>(generator());
+
+		std::ofstream(path, std::ios::binary) << data;
+		return data;
+	}
+}
+
+TEST(PartSizeHasAFloor)
+{
+	CHECK(Checksum::PartSize(100 * mebibyte, 0) == 5 * mebibyte);
+	CHECK(Checksum::PartSize(100 * mebibyte, mebibyte) == 5 * mebibyte);
+	CHECK(Checksum::PartSize(100 * mebibyte, 16 * mebibyte) == 16 * mebibyte);
+}
+
+TEST(PartSizeGrowsPastTenThousandParts)
+{
+	const std::uint64_t fileSize{ 100000 * mebibyte };
+	const std::uint64_t partSize{ Checksum::PartSize(fileSize, 5 * mebibyte) };
+
+	CHECK(partSize > 5 * mebibyte);
+	CHECK((fileSize + partSize - 1) / partSize <= 10000);
+}
+
+TEST(SinglePartETagIsTheMd5)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "small.bin" };
+	const std::string data{ WriteFile(path, 1000) };
+
+	TransferPool pool{ 4, 64 };
+	const auto eTag{ Checksum::FileETag(path, data.size(), SyncOptions{}, pool) };
+
+	CHECK(eTag.has_value());
+	CHECK(eTag && *eTag == Md5Hex(data));
+}
+
+TEST(EmptyFileETag)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "empty.bin" };
+	WriteFile(path, 0);
+
+	TransferPool pool{ 4, 64 };
+	const auto eTag{ Checksum::FileETag(path, 0, SyncOptions{}, pool) };
+
+	CHECK(eTag && *eTag == "d41d8cd98f00b204e9800998ecf8427e");
+}
+
+TEST(MultipartETagHashesThePartDigests)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "big.bin" };
+	const std::string data{ WriteFile(path, 12 * mebibyte) };
+
+	SyncOptions syncOptions{};
+	syncOptions.multipartThreshold = 5 * mebibyte;
+	syncOptions.partSize = 5 * mebibyte;
+
+	// Parts of 5, 5 and 2 MiB.
+	std::string digests{};
+	for (std::uint64_t offset = 0; offset < data.size(); offset += 5 * mebibyte)
+		digests += Md5Raw(data.substr(offset, 5 * mebibyte));
+
+	TransferPool pool{ 4, 64 };
+	const auto eTag{ Checksum::FileETag(path, data.size(), syncOptions, pool) };
+
+	CHECK(eTag.has_value());
+	CHECK(eTag && *eTag == Md5Hex(digests) + "-3");
+}
+
+TEST(SameETagIgnoresQuotes)
+{
+	CHECK(Checksum::SameETag("\"abc-2\"", "abc-2"));
+	CHECK(Checksum::SameETag("abc", "\"abc\""));
+	CHECK(!Checksum::SameETag("\"abc\"", "\"abd\""));
+	CHECK(!Checksum::SameETag("abc", "abc-1"));
+}
+
+int main()
+{
+	return Test::RunAll();
+}
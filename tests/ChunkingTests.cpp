@@ -0,0 +1,179 @@
+#include "Chunking.h"
+#include "Test.h"
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+
+namespace {
+	std::string RandomData(std::size_t size, std::uint64_t seed)
+	{
+		std::mt19937_64 generator{ seed };
+		std::string data(size, '\0');
+		for (auto& c : data)
+			c = static_cast<char>(generator());
+
+		return data;
+	}
+
+	bool Contiguous(const std::vector<Chunk>& chunks, std::uint64_t size)
+	{
+		std::uint64_t offset{ 0 };
+		for (const auto& chunk : chunks) {
+			if (chunk.offset != offset || chunk.size == 0)
+				return false;
+			offset += chunk.size;
+		}
+
+		return offset == size;
+	}
+
+	std::unordered_set<std::string> Hashes(const std::string& data, std::uint64_t averageSize)
+	{
+		std::unordered_set<std::string> hashes{};
+		for (const auto& chunk : Chunking::Split(data.data(), data.size(), averageSize))
+			hashes.insert(Chunking::Hash(data.data() + chunk.offset, chunk.size));
+
+		return hashes;
+	}
+
+	ChunkRecipe SampleRecipe()
+	{
+		ChunkRecipe recipe{ "photos/.s3sync/chunks/", 300, 128, {} };
+		recipe.chunks.push_back(Chunk{ 0, 100, std::string(64, 'a') });
+		recipe.chunks.push_back(Chunk{ 100, 200, std::string(64, 'b') });
+		return recipe;
+	}
+}
+
+TEST(ChunksCoverTheDataWithinBounds)
+{
+	constexpr std::uint64_t averageSize{ 4096 };
+	const std::string data{ RandomData(1 << 20, 1) };
+
+	const auto chunks{ Chunking::Split(data.data(), data.size(), averageSize) };
+	CHECK(Contiguous(chunks, data.size()));
+
+	bool withinBounds{ true };
+	for (std::size_t i = 0; i < chunks.size(); ++i) {
+		// Only the last chunk may come out short.
+		if (i + 1 < chunks.size())
+			withinBounds = withinBounds && chunks[i].size >= averageSize / 4;
+		withinBounds = withinBounds && chunks[i].size <= averageSize * 4;
+	}
+	CHECK(withinBounds);
+
+	// Normalized chunking keeps the average near the requested size.
+	const double average{ static_cast<double>(data.size()) / static_cast<double>(chunks.size()) };
+	CHECK(average > averageSize / 2.0 && average < averageSize * 2.0);
+}
+
+TEST(SmallAndEmptyInputs)
+{
+	CHECK(Chunking::Split(nullptr, 0, 4096).empty());
+
+	const std::string data{ RandomData(100, 2) };
+	const auto chunks{ Chunking::Split(data.data(), data.size(), 4096) };
+	CHECK(chunks.size() == 1);
+	CHECK(Contiguous(chunks, data.size()));
+}
+
+TEST(UniformDataCutsAtTheMaximum)
+{
+	constexpr std::uint64_t averageSize{ 4096 };
+	const std::string data(100000, '\0');
+
+	const auto chunks{ Chunking::Split(data.data(), data.size(), averageSize) };
+	CHECK(Contiguous(chunks, data.size()));
+	CHECK(chunks.size() > 1);
+	CHECK(chunks.front().size <= averageSize * 4);
+}
+
+TEST(BoundariesAreDeterministic)
+{
+	const std::string data{ RandomData(256 * 1024, 3) };
+
+	const auto first{ Chunking::Split(data.data(), data.size(), 4096) };
+	const auto second{ Chunking::Split(data.data(), data.size(), 4096) };
+
+	bool same{ first.size() == second.size() };
+	for (std::size_t i = 0; same && i < first.size(); ++i)
+		same = first[i].offset == second[i].offset && first[i].size == second[i].size;
+	CHECK(same);
+}
+
+TEST(AnInsertOnlyChangesNearbyChunks)
+{
+	const std::string original{ RandomData(512 * 1024, 4) };
+	std::string edited{ original };
+	edited.insert(200 * 1024, "a few inserted bytes");
+
+	const auto before{ Hashes(original, 4096) };
+	const auto after{ Hashes(edited, 4096) };
+
+	std::size_t shared{ 0 };
+	for (const auto& hash : after)
+		shared += before.contains(hash);
+
+	// Content-defined boundaries resynchronize right after the edit.
+	CHECK(shared + 4 >= before.size());
+}
+
+TEST(HashIsLowercaseHexSha256)
+{
+	const std::string abc{ "abc" };
+	CHECK(Chunking::Hash(abc.data(), abc.size()) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	CHECK(Chunking::Hash(nullptr, 0) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+}
+
+TEST(RecipeRoundTrip)
+{
+	const ChunkRecipe recipe{ SampleRecipe() };
+
+	std::istringstream in{ Chunking::Serialize(recipe) };
+	const auto parsed{ Chunking::Parse(in) };
+
+	CHECK(parsed.has_value());
+	CHECK(parsed && parsed->chunkPrefix == recipe.chunkPrefix && parsed->size == recipe.size && parsed->averageSize == recipe.averageSize);
+	CHECK(parsed && parsed->chunks.size() == 2);
+	CHECK(parsed && parsed->chunks.size() == 2 && parsed->chunks[1].offset == 100 && parsed->chunks[1].size == 200 && parsed->chunks[1].hash == recipe.chunks[1].hash);
+}
+
+TEST(RecipeRejectsTruncation)
+{
+	const std::string serialized{ Chunking::Serialize(SampleRecipe()) };
+
+	bool allRejected{ true };
+	for (std::size_t length = 0; length < serialized.size(); ++length) {
+		std::istringstream in{ serialized.substr(0, length) };
+		allRejected = allRejected && !Chunking::Parse(in).has_value();
+	}
+	CHECK(allRejected);
+}
+
+TEST(RecipeRejectsHugePrefixLength)
+{
+	std::string serialized{ Chunking::Serialize(SampleRecipe()) };
+	// The prefix length follows the magic and the version.
+	const std::uint32_t length{ 0xfffffff0 };
+	serialized.replace(8, sizeof(length), reinterpret_cast<const char*>(&length), sizeof(length));
+
+	std::istringstream in{ serialized };
+	CHECK(!Chunking::Parse(in).has_value());
+}
+
+TEST(RecipeRejectsChunksThatDontAddUp)
+{
+	ChunkRecipe recipe{ SampleRecipe() };
+	recipe.size = 301;
+
+	std::istringstream in{ Chunking::Serialize(recipe) };
+	CHECK(!Chunking::Parse(in).has_value());
+}
+
+int main()
+{
+	return Test::RunAll();
+}
@@ -0,0 +1,159 @@
+#include "Manifest.h"
+#include "Test.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace {
+	template<typename T>
+	void Append(std::string& out, T value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	// A manifest header claiming count entries, followed by body as is.
+	void WriteRaw(const std::filesystem::path& path, std::uint64_t count, const std::string& body)
+	{
+		std::string data{ "S3SM" };
+		Append(data, std::uint32_t{ 1 });
+		Append(data, std::uint64_t{ 3 });
+		Append(data, count);
+		data += body;
+
+		std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+	}
+}
+
+TEST(MissingFileLoadsEmpty)
+{
+	Test::TempDirectory directory{};
+	Manifest manifest{ directory.Path() / "none.manifest" };
+
+	CHECK(manifest.Load().has_value());
+	CHECK(manifest.Empty());
+	CHECK(manifest.Generation() == 0);
+}
+
+TEST(SaveAndLoadRoundTrip)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "state" / "a.manifest" };
+
+	{
+		Manifest manifest{ path };
+		CHECK(manifest.Load().has_value());
+		manifest.Update("a.txt", ManifestEntry{ 10, 1234, "\"etag-a\"", 0 });
+		manifest.Update("dir/b.bin", ManifestEntry{ 1ull << 40, -5, "", 0 });
+		CHECK(manifest.Save().has_value());
+	}
+
+	Manifest loaded{ path };
+	CHECK(loaded.Load().has_value());
+	// Each load starts the next generation.
+	CHECK(loaded.Generation() == 1);
+
+	const auto a{ loaded.Find("a.txt") };
+	CHECK(a && a->size == 10 && a->modifiedTime == 1234 && a->eTag == "\"etag-a\"" && a->generation == 0);
+
+	const auto b{ loaded.Find("dir/b.bin") };
+	CHECK(b && b->size == (1ull << 40) && b->modifiedTime == -5 && b->eTag.empty());
+
+	CHECK(!loaded.Find("c").has_value());
+}
+
+TEST(PruneDropsEntriesNotTouchedThisRun)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "a.manifest" };
+
+	{
+		Manifest manifest{ path };
+		CHECK(manifest.Load().has_value());
+		manifest.Update("kept", ManifestEntry{ 1, 1, "k", 0 });
+		manifest.Update("gone", ManifestEntry{ 2, 2, "g", 0 });
+		CHECK(manifest.Save().has_value());
+	}
+
+	Manifest manifest{ path };
+	CHECK(manifest.Load().has_value());
+	manifest.Touch("kept");
+	manifest.Prune();
+
+	CHECK(manifest.Find("kept").has_value());
+	CHECK(!manifest.Find("gone").has_value());
+}
+
+TEST(RejectsBadMagic)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "bad.manifest" };
+	std::ofstream(path, std::ios::binary) << "NOPE and some more bytes";
+
+	Manifest manifest{ path };
+	CHECK(!manifest.Load().has_value());
+	CHECK(manifest.Empty());
+}
+
+TEST(RejectsCountTheFileCantHold)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "count.manifest" };
+	WriteRaw(path, 1ull << 60, {});
+
+	Manifest manifest{ path };
+	CHECK(!manifest.Load().has_value());
+	CHECK(manifest.Empty());
+}
+
+TEST(RejectsStringLongerThanTheFile)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "length.manifest" };
+
+	// A key claiming almost 4 GiB, with a few bytes behind it.
+	std::string body{};
+	Append(body, std::uint32_t{ 0xfffffff0 });
+	body += std::string(64, 'k');
+	WriteRaw(path, 1, body);
+
+	Manifest manifest{ path };
+	CHECK(!manifest.Load().has_value());
+	CHECK(manifest.Empty());
+}
+
+TEST(RejectsTruncatedEntry)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "short.manifest" };
+
+	{
+		Manifest manifest{ path };
+		CHECK(manifest.Load().has_value());
+		manifest.Update("a.txt", ManifestEntry{ 10, 1234, "etag", 0 });
+		CHECK(manifest.Save().has_value());
+	}
+
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+
+	Manifest manifest{ path };
+	CHECK(!manifest.Load().has_value());
+	CHECK(manifest.Empty());
+}
+
+TEST(PathForDependsOnDirectoryAndBucket)
+{
+	Test::TempDirectory directory{};
+	const auto state{ directory.Path() / "state" };
+
+	const auto first{ Manifest::PathFor(state, directory.Path(), "bucket") };
+	CHECK(first == Manifest::PathFor(state, directory.Path(), "bucket"));
+	CHECK(first != Manifest::PathFor(state, directory.Path(), "other"));
+	CHECK(first.parent_path() == state / "manifests");
+	CHECK(first.extension() == ".manifest");
+}
+
+int main()
+{
+	return Test::RunAll();
+}
@@ -0,0 +1,147 @@
+#include "PathFilter.h"
+#include "Test.h"
+
+#include <algorithm>
+
+TEST(EmptyFilterAdmitsEverything)
+{
+	const PathFilter filter{};
+
+	CHECK(filter.Empty());
+	CHECK(filter.Admits("a/b/c.txt"));
+	CHECK(filter.Enters("a/b"));
+	CHECK(filter.ListPrefixes() == std::vector<std::string>{ "" });
+}
+
+TEST(PlainNameMatchesAtAnyDepth)
+{
+	const PathFilter filter{ {}, { "node_modules", "*.log" } };
+
+	CHECK(!filter.Admits("node_modules"));
+	CHECK(!filter.Admits("node_modules/a.js"));
+	CHECK(!filter.Admits("web/node_modules/a/b.js"));
+	CHECK(!filter.Enters("web/node_modules"));
+	CHECK(!filter.Admits("build.log"));
+	CHECK(!filter.Admits("logs/today/build.log"));
+	CHECK(filter.Admits("node_modules.txt"));
+	CHECK(filter.Admits("web/main.js"));
+	CHECK(filter.Admits("build.log.gz"));
+	CHECK(filter.Enters("web"));
+}
+
+TEST(SlashAnchorsToTheRoot)
+{
+	const PathFilter filter{ {}, { "/build", "docs/*.tmp" } };
+
+	CHECK(!filter.Admits("build/out.o"));
+	CHECK(filter.Admits("src/build/out.o"));
+	CHECK(!filter.Admits("docs/a.tmp"));
+	CHECK(filter.Admits("docs/sub/a.tmp"));
+	CHECK(filter.Admits("other/docs/a.tmp"));
+}
+
+TEST(TrailingSlashOnlyMatchesDirectories)
+{
+	const PathFilter filter{ {}, { "cache/" } };
+
+	CHECK(filter.Admits("cache"));
+	CHECK(!filter.Admits("cache/entry"));
+	CHECK(!filter.Admits("a/cache/entry"));
+	CHECK(!filter.Enters("a/cache"));
+}
+
+TEST(DoubleStarSpansDirectories)
+{
+	const PathFilter filter{ {}, { "a/**/z.txt", "**/tmp" } };
+
+	CHECK(!filter.Admits("a/z.txt"));
+	CHECK(!filter.Admits("a/b/c/z.txt"));
+	CHECK(filter.Admits("b/a/z.txt"));
+	CHECK(!filter.Admits("tmp/x"));
+	CHECK(!filter.Admits("deep/down/tmp/x"));
+}
+
+TEST(WildcardsStayInsideOneSegment)
+{
+	const PathFilter filter{ {}, { "/src/*.o" } };
+
+	CHECK(!filter.Admits("src/a.o"));
+	CHECK(filter.Admits("src/sub/a.o"));
+}
+
+TEST(CharacterClassesAndEscapes)
+{
+	const PathFilter filter{ {}, { "file[0-9].txt", "note[!a].md", "\\*star", "[]x]y" } };
+
+	CHECK(!filter.Admits("file3.txt"));
+	CHECK(filter.Admits("filex.txt"));
+	CHECK(!filter.Admits("noteb.md"));
+	CHECK(filter.Admits("notea.md"));
+	CHECK(!filter.Admits("*star"));
+	CHECK(filter.Admits("xstar"));
+	CHECK(!filter.Admits("]y"));
+	CHECK(!filter.Admits("xy"));
+	CHECK(filter.Admits("zy"));
+}
+
+TEST(QuestionMarkMatchesOneCharacter)
+{
+	const PathFilter filter{ {}, { "?.bak" } };
+
+	CHECK(!filter.Admits("a.bak"));
+	CHECK(filter.Admits("ab.bak"));
+	CHECK(filter.Admits(".bak"));
+}
+
+TEST(IncludesLimitWhatPasses)
+{
+	const PathFilter filter{ { "src/", "*.md" }, {} };
+
+	CHECK(filter.Admits("src/main.cpp"));
+	CHECK(filter.Admits("src/deep/x.h"));
+	CHECK(filter.Admits("README.md"));
+	CHECK(filter.Admits("docs/guide.md"));
+	CHECK(!filter.Admits("build/out.o"));
+	CHECK(!filter.Admits("src"));
+}
+
+TEST(IncludesStillEnterParentsOfAnchoredPatterns)
+{
+	const PathFilter filter{ { "assets/images/*.png" }, {} };
+
+	CHECK(filter.Enters("assets"));
+	CHECK(filter.Enters("assets/images"));
+	CHECK(!filter.Enters("assets/fonts"));
+	CHECK(!filter.Enters("src"));
+	CHECK(filter.Admits("assets/images/logo.png"));
+	CHECK(!filter.Admits("assets/images/logo.jpg"));
+}
+
+TEST(ExcludesWinOverIncludes)
+{
+	const PathFilter filter{ { "src/" }, { "generated" } };
+
+	CHECK(filter.Admits("src/a.cpp"));
+	CHECK(!filter.Admits("src/generated/a.cpp"));
+	CHECK(!filter.Enters("src/generated"));
+}
+
+TEST(ListPrefixesCoversIncludes)
+{
+	const PathFilter anchored{ { "logs/2024/", "logs/2024/jan/", "data/*.csv", "/config.json" }, {} };
+	const auto prefixes{ anchored.ListPrefixes() };
+
+	CHECK(prefixes.size() == 3);
+	CHECK(std::ranges::find(prefixes, "logs/2024/") != prefixes.end());
+	CHECK(std::ranges::find(prefixes, "data/") != prefixes.end());
+	CHECK(std::ranges::find(prefixes, "config.json") != prefixes.end());
+
+	// An unanchored include can match anywhere, so nothing narrows the listing.
+	const PathFilter anywhere{ { "logs/", "*.md" }, {} };
+	CHECK(anywhere.ListPrefixes() == std::vector<std::string>{ "" });
+}
+
+int main()
+{
+	return Test::RunAll();
+}
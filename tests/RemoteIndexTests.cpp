@@ -0,0 +1,96 @@
+#include "RemoteIndex.h"
+#include "Test.h"
+
+#include <aws/core/utils/DateTime.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+	Aws::S3::Model::Object MakeObject(const std::string& key, long long size, const std::string& eTag, std::int64_t lastModifiedMs = 0)
+	{
+		Aws::S3::Model::Object object{};
+		object.WithKey(Aws::String{ key }).WithSize(size).WithETag(Aws::String{ eTag }).WithLastModified(Aws::Utils::DateTime(lastModifiedMs));
+		return object;
+	}
+}
+
+TEST(FindsWhatWasAdded)
+{
+	RemoteIndex index{};
+	index.Add({ MakeObject("a.txt", 10, "\"e1\"", 5000), MakeObject("dir/b.txt", 20, "\"e2\"") });
+
+	CHECK(index.Size() == 2);
+
+	const auto a{ index.Find("a.txt") };
+	CHECK(a.has_value());
+	CHECK(a && a->key == "a.txt" && a->size == 10 && a->eTag == "\"e1\"" && a->lastModified == 5);
+
+	const auto b{ index.Find("dir/b.txt") };
+	CHECK(b && b->size == 20 && b->eTag == "\"e2\"");
+
+	CHECK(!index.Find("missing").has_value());
+	CHECK(!index.Find("a.tx").has_value());
+}
+
+TEST(EmptyIndexFindsNothing)
+{
+	const RemoteIndex index{};
+
+	CHECK(index.Size() == 0);
+	CHECK(!index.Find("a").has_value());
+}
+
+TEST(LaterPageReplacesTheSameKey)
+{
+	RemoteIndex index{};
+	index.Add({ MakeObject("a.txt", 10, "old") });
+	index.Add({ MakeObject("a.txt", 11, "new") });
+
+	CHECK(index.Size() == 1);
+	const auto a{ index.Find("a.txt") };
+	CHECK(a && a->size == 11 && a->eTag == "new");
+}
+
+TEST(ManyObjectsSurviveGrowth)
+{
+	RemoteIndex index{};
+
+	// Enough pages and keys to grow the table several times and fill more than one text block.
+	const std::string padding(300, 'x');
+	for (int page = 0; page < 10; ++page) {
+		Aws::Vector<Aws::S3::Model::Object> objects{};
+		for (int i = 0; i < 1000; ++i) {
+			const int n{ page * 1000 + i };
+			objects.push_back(MakeObject("key-" + std::to_string(n) + "-" + padding, n, "etag-" + std::to_string(n)));
+		}
+		index.Add(objects);
+	}
+
+	CHECK(index.Size() == 10000);
+
+	bool allFound{ true };
+	for (int n = 0; n < 10000; n += 7) {
+		const auto object{ index.Find("key-" + std::to_string(n) + "-" + padding) };
+		allFound = allFound && object && object->size == static_cast<std::uint64_t>(n) && object->eTag == "etag-" + std::to_string(n);
+	}
+	CHECK(allFound);
+}
+
+TEST(ForEachSortedVisitsKeysInOrder)
+{
+	RemoteIndex index{};
+	// As a fanned-out listing delivers them: each page sorted, the pages interleaved.
+	index.Add({ MakeObject("m/1", 1, "a"), MakeObject("m/2", 2, "b") });
+	index.Add({ MakeObject("a/1", 3, "c"), MakeObject("z/1", 4, "d") });
+
+	std::vector<std::string> keys{};
+	index.ForEachSorted([&](const RemoteObject& object) { keys.emplace_back(object.key); });
+
+	CHECK((keys == std::vector<std::string>{ "a/1", "m/1", "m/2", "z/1" }));
+}
+
+int main()
+{
+	return Test::RunAll();
+}
@@ -0,0 +1,43 @@
+#include "S3Location.h"
+#include "Test.h"
+
+TEST(BucketOnly)
+{
+	const S3Location location{ S3Location::Parse("photos") };
+
+	CHECK(location.bucket == "photos");
+	CHECK(location.prefix.empty());
+	CHECK(location.KeyFor("a/b.jpg") == "a/b.jpg");
+}
+
+TEST(PrefixAlwaysEndsWithSlash)
+{
+	CHECK(S3Location::Parse("photos/2024").prefix == "2024/");
+	CHECK(S3Location::Parse("photos/2024/").prefix == "2024/");
+	CHECK(S3Location::Parse("photos/2024/jan").prefix == "2024/jan/");
+}
+
+TEST(SchemeAndExtraSlashesAreDropped)
+{
+	const S3Location location{ S3Location::Parse("s3://photos//2024") };
+
+	CHECK(location.bucket == "photos");
+	CHECK(location.prefix == "2024/");
+	CHECK(S3Location::Parse("s3://photos/").prefix.empty());
+}
+
+TEST(KeyForAndRelativeKeyRoundTrip)
+{
+	const S3Location location{ S3Location::Parse("photos/2024") };
+
+	CHECK(location.KeyFor("jan/a.jpg") == "2024/jan/a.jpg");
+	CHECK(location.RelativeKey("2024/jan/a.jpg") == "jan/a.jpg");
+	// A key outside the prefix comes back unchanged.
+	CHECK(location.RelativeKey("2023/a.jpg") == "2023/a.jpg");
+	CHECK(location.RelativeKey("2024-old/a.jpg") == "2024-old/a.jpg");
+}
+
+int main()
+{
+	return Test::RunAll();
+}
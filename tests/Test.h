@@ -0,0 +1,83 @@
+#pragma once
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Just enough of a test harness to need no dependency: TEST registers a case, CHECK records a
+// failure without stopping the case, and each test file's main returns Test::RunAll() to CTest.
+namespace Test {
+	struct Case {
+		std::string_view name;
+		void (*run)();
+	};
+
+	inline std::vector<Case>& Cases()
+	{
+		static std::vector<Case> cases{};
+		return cases;
+	}
+
+	inline int failures{ 0 };
+
+	struct Registration {
+		Registration(std::string_view name, void (*run)())
+		{
+			Cases().push_back(Case{ name, run });
+		}
+	};
+
+	inline void Fail(std::string_view expression, std::string_view file, int line)
+	{
+		++failures;
+		std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed\n";
+	}
+
+	inline int RunAll()
+	{
+		for (const auto& test : Cases()) {
+			const int before{ failures };
+			test.run();
+			std::cout << (failures == before ? "[ok] " : "[FAILED] ") << test.name << "\n";
+		}
+
+		return failures == 0 ? 0 : 1;
+	}
+
+	// A fresh directory under the system temp directory, removed with everything in it.
+	class TempDirectory {
+	private:
+		std::filesystem::path path;
+
+	public:
+		TempDirectory()
+			: path{ std::filesystem::temp_directory_path() / ("s3sync-test-" + std::to_string(std::random_device{}())) }
+		{
+			std::filesystem::create_directories(path);
+		}
+
+		~TempDirectory()
+		{
+			std::error_code ec{};
+			std::filesystem::remove_all(path, ec);
+		}
+
+		TempDirectory(const TempDirectory&) = delete;
+		TempDirectory& operator=(const TempDirectory&) = delete;
+
+		const std::filesystem::path& Path() const { return path; }
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static const Test::Registration name##Registration{ #name, name }; \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) \
+			Test::Fail(#expression, __FILE__, __LINE__); \
+	} while (false)
@@ -0,0 +1,132 @@
+#include "TransferJournal.h"
+#include "Test.h"
+
+#include <cstdint>
+#include <fstream>
+
+namespace {
+	const JournalHeader header{ "bucket", "dir/big.bin", 64ull << 20, 1700000000000000000, 8ull << 20, "upload-id" };
+
+	bool SameHeader(const JournalHeader& lhs, const JournalHeader& rhs)
+	{
+		return lhs.bucket == rhs.bucket && lhs.key == rhs.key && lhs.size == rhs.size
+			&& lhs.modifiedTime == rhs.modifiedTime && lhs.partSize == rhs.partSize && lhs.id == rhs.id;
+	}
+}
+
+TEST(MissingJournalDoesNotLoad)
+{
+	Test::TempDirectory directory{};
+	TransferJournal journal{ directory.Path() / "none.journal" };
+
+	CHECK(!journal.Load());
+	CHECK(journal.Parts().empty());
+}
+
+TEST(RecordedPartsSurviveAReload)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "journals" / "a.journal" };
+
+	{
+		TransferJournal journal{ path };
+		CHECK(journal.Begin(header));
+		CHECK(journal.Record(1, "\"etag-1\""));
+		CHECK(journal.Record(3, "\"etag-3\""));
+		CHECK(journal.Record(2));
+	}
+
+	TransferJournal journal{ path };
+	CHECK(journal.Load());
+	CHECK(SameHeader(journal.Header(), header));
+	CHECK(journal.Parts().size() == 3);
+	CHECK(journal.Parts().at(1) == "\"etag-1\"");
+	CHECK(journal.Parts().at(2).empty());
+	CHECK(journal.Parts().at(3) == "\"etag-3\"");
+}
+
+TEST(TornRecordIsDroppedAndOverwritten)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "a.journal" };
+
+	{
+		TransferJournal journal{ path };
+		CHECK(journal.Begin(header));
+		CHECK(journal.Record(1, "one"));
+	}
+
+	// Half a record, as a crash in the middle of an append leaves it.
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::app);
+		const std::uint32_t part{ 2 };
+		out.write(reinterpret_cast<const char*>(&part), sizeof(part));
+		out.write("\x03\x00", 2);
+	}
+
+	{
+		TransferJournal journal{ path };
+		CHECK(journal.Load());
+		CHECK(journal.Parts().size() == 1);
+		CHECK(journal.Continue());
+		CHECK(journal.Record(2, "two"));
+	}
+
+	TransferJournal journal{ path };
+	CHECK(journal.Load());
+	CHECK(journal.Parts().size() == 2);
+	CHECK(journal.Parts().at(1) == "one");
+	CHECK(journal.Parts().at(2) == "two");
+}
+
+TEST(CorruptHeaderDoesNotLoad)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "a.journal" };
+
+	// The right magic and version, then a bucket name claiming almost 4 GiB.
+	{
+		std::ofstream out(path, std::ios::binary);
+		out.write("S3SJ", 4);
+		const std::uint32_t version{ 1 };
+		const std::uint32_t length{ 0xfffffff0 };
+		out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		out << "bucket";
+	}
+
+	TransferJournal journal{ path };
+	CHECK(!journal.Load());
+	CHECK(journal.Header().bucket.empty());
+}
+
+TEST(DiscardRemovesTheFile)
+{
+	Test::TempDirectory directory{};
+	const auto path{ directory.Path() / "a.journal" };
+
+	TransferJournal journal{ path };
+	CHECK(journal.Begin(header));
+	journal.Discard();
+
+	CHECK(!std::filesystem::exists(path));
+	CHECK(journal.Parts().empty());
+}
+
+TEST(PathForSeparatesKindsAndKeys)
+{
+	Test::TempDirectory directory{};
+	const auto state{ directory.Path() / "state" };
+	const auto local{ directory.Path() / "big.bin" };
+
+	const auto upload{ TransferJournal::PathFor(state, "upload", local, "bucket", "big.bin") };
+	CHECK(upload == TransferJournal::PathFor(state, "upload", local, "bucket", "big.bin"));
+	CHECK(upload != TransferJournal::PathFor(state, "download", local, "bucket", "big.bin"));
+	CHECK(upload != TransferJournal::PathFor(state, "upload", local, "bucket", "other.bin"));
+	CHECK(upload.parent_path() == state / "journals");
+}
+
+int main()
+{
+	return Test::RunAll();
+}